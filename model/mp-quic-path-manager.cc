@@ -145,6 +145,18 @@ MpQuicPathManager::AddSubflowWithPeerAddress(Address localAddress, Address peerA
   return sFlow;
 }
 
+void
+MpQuicPathManager::SetSubflowState(Ptr<MpQuicSubFlow> sFlow, MpQuicSubFlow::SubflowStates_t state)
+{
+  NS_LOG_FUNCTION(this << state);
+  if (sFlow->m_subflowState == state)
+  {
+    return;
+  }
+  sFlow->m_subflowState = state;
+  m_socket->InvalidateActiveSubflows();
+}
+
 
 void
 MpQuicPathManager::SetSocket(Ptr<QuicSocketBase> sock)
@@ -54,6 +54,17 @@ public:
   Ptr<MpQuicSubFlow> InitialSubflow0 (Address localAddress, Address peerAddress);
   Ptr<MpQuicSubFlow> AddSubflow(Address address, Address from, uint8_t pathId);
   Ptr<MpQuicSubFlow> AddSubflowWithPeerAddress(Address localAddress, Address peerAddress, uint8_t pathId);
+
+  /**
+   * \brief Change the state of a subflow
+   *
+   * The socket's cached list of active subflows is invalidated, so the
+   * scheduler picks up the change at its next decision.
+   *
+   * \param sFlow the subflow
+   * \param state the new state
+   */
+  void SetSubflowState(Ptr<MpQuicSubFlow> sFlow, MpQuicSubFlow::SubflowStates_t state);
  
   void SetSocket(Ptr<QuicSocketBase> sock);
   void SetSegSize(uint32_t size);
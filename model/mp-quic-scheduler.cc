@@ -29,6 +29,8 @@
 #include "quic-stream.h"
 #include "ns3/node.h"
 #include "ns3/string.h"
+#include "ns3/abort.h"
+#include "ns3/simulator.h"
 
 #include <algorithm>
 #include <iostream>
@@ -98,11 +100,13 @@ MpQuicScheduler::MpQuicScheduler ()
   : Object (),
   m_socket(0),
   m_lastUsedPathId(0),
+  m_subflowsVersion(0),
   m_rounds(0),
   m_reward(0),
   m_select(0)
 {
   NS_LOG_FUNCTION_NOARGS ();
+  m_uniform = CreateObject<UniformRandomVariable> ();
   m_lastUpdateRounds = 1;
   m_e = 0;
   m_rewards.push_back(0);
@@ -118,110 +122,231 @@ MpQuicScheduler::~MpQuicScheduler ()
 
 
 
-std::vector<double> 
-MpQuicScheduler::GetNextPathIdToUse()
+void
+MpQuicScheduler::GetNextPathIdToUse (std::vector<double> &tosend)
 {
-  m_subflows = m_socket->GetActiveSubflows();
-  std::vector<double> tosend(m_subflows.size(), 0.0);
+  NS_LOG_FUNCTION (this);
+  // the active subflows are only copied again after a path changed state
+  uint32_t version = m_socket->GetActiveSubflowsVersion ();
+  if (version != m_subflowsVersion)
+  {
+    m_subflows = m_socket->GetActiveSubflows ();
+    m_subflowsVersion = version;
+  }
   if (m_subflows.empty())
   {
-    tosend.push_back(1.0);
-    return tosend;
+    tosend.assign (1, 1.0);
+    return;
   }
   switch (m_schedulerType)
   {
     case ROUND_ROBIN:
-      tosend = RoundRobin();
+      RoundRobin(tosend);
       break;
 
     case MIN_RTT:
-      tosend = MinRtt();
+      MinRtt(tosend);
       break;
     
     case BLEST:
-      tosend = Blest();
+      Blest(tosend);
       break;
 
     case ECF:
-      tosend = Ecf();
+      Ecf(tosend);
       break;
 
     case PEEKABOO:
-      tosend = Peekaboo();
+      Peekaboo(tosend);
       break;
             
     case MAB_DELAY:
-      tosend = MabDelay();
+      MabDelay(tosend);
+      break;
+
+    case DEADLINE:
+      Deadline(tosend);
       break;
 
     default:
-      tosend = RoundRobin();
+      RoundRobin(tosend);
       break;
       
   }
-
-  return tosend;
 }
 
-std::vector<double>
-MpQuicScheduler::RoundRobin()
+void
+MpQuicScheduler::RoundRobin(std::vector<double> &tosend)
 {
-  std::vector<double> tosend(m_subflows.size(), 0.0);
+  tosend.assign (m_subflows.size (), 0.0);
   if (m_subflows.size() <= 1){
     m_lastUsedPathId = 0;
     tosend[m_lastUsedPathId] = 1.0;
-    return tosend;
+    return;
   }
 
   m_lastUsedPathId = (m_lastUsedPathId + 1) % m_subflows.size();
 
   tosend[m_lastUsedPathId] = 1.0;
-  return tosend;
 }
 
-std::vector<double>
-MpQuicScheduler::MinRtt()
+void
+MpQuicScheduler::RankPathsByRtt (bool preferHigherId)
+{
+  NS_LOG_FUNCTION (this << preferHigherId);
+  m_rttOrder.resize (m_subflows.size ());
+  for (uint8_t i = 0; i < m_subflows.size (); i++)
+    {
+      m_rttOrder[i] = i;
+    }
+  std::sort (m_rttOrder.begin (), m_rttOrder.end (),
+             [this, preferHigherId] (uint8_t a, uint8_t b)
+  {
+    Time rttA = m_subflows[a]->m_tcb->m_lastRtt;
+    Time rttB = m_subflows[b]->m_tcb->m_lastRtt;
+    if (rttA != rttB)
+      {
+        return rttA < rttB;
+      }
+    return preferHigherId ? a > b : a < b;
+  });
+}
+
+uint8_t
+MpQuicScheduler::GetUnprobedPath () const
+{
+  // path 0 carries the handshake, so it always has an RTT sample
+  for (uint8_t i = 1; i < m_subflows.size (); i++)
+    {
+      if (m_subflows[i]->m_tcb->m_lastRtt.Get ().GetSeconds () == 0)
+        {
+          return i;
+        }
+    }
+  return m_subflows.size ();
+}
+
+uint8_t
+MpQuicScheduler::GetFastestAvailablePath (uint8_t from)
+{
+  NS_LOG_FUNCTION (this << (uint16_t) from);
+  for (uint8_t rank = from; rank < m_rttOrder.size (); rank++)
+    {
+      if (m_socket->AvailableWindow (m_rttOrder[rank]) > 0)
+        {
+          return m_rttOrder[rank];
+        }
+    }
+  return m_rttOrder.back ();
+}
+
+void
+MpQuicScheduler::MinRtt(std::vector<double> &tosend)
 {
   NS_LOG_FUNCTION (this);
-  std::vector<double> tosend(m_subflows.size(), 0.0);
+  tosend.assign (m_subflows.size (), 0.0);
 
   if (m_subflows.size() <= 1){
     m_lastUsedPathId = 0;
     tosend[m_lastUsedPathId] = 1.0;
-    return tosend;
+    return;
   }
 
-  if (m_subflows[1]->m_tcb->m_lastRtt.Get().GetSeconds() == 0) {
-    m_lastUsedPathId = 1;
+  uint8_t unprobedPathId = GetUnprobedPath ();
+  if (unprobedPathId < m_subflows.size ()) {
+    m_lastUsedPathId = unprobedPathId;
     tosend[m_lastUsedPathId] = 1.0;
-    return tosend;
+    return;
   }
 
-  Time rttS;
-  Time rttF;
-  uint8_t fastPathId = 1;
-  uint8_t slowPathId = 0;
+  RankPathsByRtt (true);
+  m_lastUsedPathId = GetFastestAvailablePath (0);
 
-  if (m_subflows[0]->m_tcb->m_lastRtt >= m_subflows[1]->m_tcb->m_lastRtt){
-    rttS = m_subflows[0]->m_tcb->m_lastRtt;
-    rttF = m_subflows[1]->m_tcb->m_lastRtt;
-    slowPathId = 0;
-    fastPathId = 1;
-  } else {
-    rttS = m_subflows[1]->m_tcb->m_lastRtt;
-    rttF = m_subflows[0]->m_tcb->m_lastRtt;
-    slowPathId = 1;
-    fastPathId = 0;
+  tosend[m_lastUsedPathId] = 1.0;
+}
+
+Time
+MpQuicScheduler::EstimateDeliveryTime (Ptr<const QuicSocketState> tcb)
+{
+  double rtt = tcb->m_smoothedRtt.GetSeconds ();
+  uint32_t cWnd = tcb->m_cWnd.Get ();
+  uint64_t needed = (uint64_t) tcb->m_bytesInFlight.Get () + tcb->m_segmentSize;
+  double wait = 0;
+  if (cWnd > 0 and needed > cWnd)
+    {
+      // roughly one RTT per congestion window of data ahead of the frame
+      wait = rtt * (needed - cWnd) / cWnd;
+    }
+  return Seconds (rtt / 2 + wait);
+}
+
+void
+MpQuicScheduler::Deadline(std::vector<double> &tosend)
+{
+  NS_LOG_FUNCTION (this);
+  tosend.assign (m_subflows.size (), 0.0);
+
+  if (m_subflows.size() <= 1){
+    m_lastUsedPathId = 0;
+    tosend[m_lastUsedPathId] = 1.0;
+    return;
   }
 
-  if (m_socket->AvailableWindow (fastPathId) > 0){
-    m_lastUsedPathId = fastPathId;
-  }else {
-    m_lastUsedPathId = slowPathId;
+  uint8_t unprobedPathId = GetUnprobedPath ();
+  if (unprobedPathId < m_subflows.size ()) {
+    m_lastUsedPathId = unprobedPathId;
+    tosend[m_lastUsedPathId] = 1.0;
+    return;
   }
 
+  m_deliveryTimes.resize (m_subflows.size ());
+  uint8_t fastPathId = 0;
+  for (uint8_t i = 0; i < m_subflows.size (); i++)
+    {
+      m_deliveryTimes[i] = EstimateDeliveryTime (m_subflows[i]->m_tcb);
+      if (m_deliveryTimes[i] < m_deliveryTimes[fastPathId])
+        {
+          fastPathId = i;
+        }
+    }
+
+  // frames that are late even on the fastest path give way to the others;
+  // they keep reporting their original deadline, which no path meets, so
+  // they go on the fastest path once they are back at the head
+  Time now = Simulator::Now ();
+  m_socket->DeprioritizeLateFrames (now + m_deliveryTimes[fastPathId]);
+  Time deadline = m_socket->GetTxHeadDeadline ();
+
+  // without a deadline, the fastest path that can send is used; otherwise the
+  // slowest path that can send and still meets the deadline, which leaves the
+  // faster paths to more urgent frames. If no path qualifies, the frame waits
+  // for the fastest one
+  m_lastUsedPathId = fastPathId;
+  bool found = false;
+  for (uint8_t i = 0; i < m_subflows.size (); i++)
+    {
+      if (m_socket->AvailableWindow (i) == 0 or now + m_deliveryTimes[i] > deadline)
+        {
+          continue;
+        }
+      if (!found
+          or (deadline == Time::Max () and m_deliveryTimes[i] < m_deliveryTimes[m_lastUsedPathId])
+          or (deadline != Time::Max () and m_deliveryTimes[i] > m_deliveryTimes[m_lastUsedPathId]))
+        {
+          m_lastUsedPathId = i;
+          found = true;
+        }
+    }
+  NS_LOG_INFO ("Head deadline " << deadline << " path " << (uint16_t) m_lastUsedPathId
+                                << " estimated delivery " << m_deliveryTimes[m_lastUsedPathId]);
+
   tosend[m_lastUsedPathId] = 1.0;
-  return tosend;
+}
+
+bool
+MpQuicScheduler::IsPerPacket () const
+{
+  return m_schedulerType == DEADLINE;
 }
 
 void
@@ -232,45 +357,36 @@ MpQuicScheduler::SetSocket(Ptr<QuicSocketBase> sock)
 }
 
 
-std::vector<double>
-MpQuicScheduler::Blest() //only allow two subflows
+void
+MpQuicScheduler::Blest(std::vector<double> &tosend)
 {
   NS_LOG_FUNCTION (this);
-  std::vector<double> tosend(m_subflows.size(), 0.0);
+  tosend.assign (m_subflows.size (), 0.0);
 
   if (m_subflows.size() <= 1){
     m_lastUsedPathId = 0;
     tosend[m_lastUsedPathId] = 1.0;
-    return tosend;
+    return;
   }
 
-  if (m_subflows[1]->m_tcb->m_lastRtt.Get().GetSeconds() == 0) {
-    m_lastUsedPathId = 1;
+  uint8_t unprobedPathId = GetUnprobedPath ();
+  if (unprobedPathId < m_subflows.size ()) {
+    m_lastUsedPathId = unprobedPathId;
     tosend[m_lastUsedPathId] = 1.0;
-    return tosend;
+    return;
   }
-  
-  Time rttS;
-  Time rttF;
-  uint8_t fastPathId = 1;
-  uint8_t slowPathId = 0;
-  uint32_t mss = m_socket->GetSegSize();
 
-  if (m_subflows[0]->m_tcb->m_lastRtt > m_subflows[1]->m_tcb->m_lastRtt){
-    rttS = m_subflows[0]->m_tcb->m_lastRtt;
-    rttF = m_subflows[1]->m_tcb->m_lastRtt;
-    slowPathId = 0;
-    fastPathId = 1;
-  } else {
-    rttS = m_subflows[1]->m_tcb->m_lastRtt;
-    rttF = m_subflows[0]->m_tcb->m_lastRtt;
-    slowPathId = 1;
-    fastPathId = 0;
-  }
+  RankPathsByRtt (false);
+  uint8_t fastPathId = m_rttOrder[0];
+  uint32_t mss = m_socket->GetSegSize();
 
   if (m_socket->AvailableWindow (fastPathId) > 0){
     m_lastUsedPathId = fastPathId;
   } else {
+    // the best alternative is the fastest other path that can send
+    uint8_t slowPathId = GetFastestAvailablePath (1);
+    Time rttS = m_subflows[slowPathId]->m_tcb->m_lastRtt;
+    Time rttF = m_subflows[fastPathId]->m_tcb->m_lastRtt;
     double_t rtts = rttS.GetSeconds()/rttF.GetSeconds();
     double_t cwndF = m_subflows[fastPathId]->m_tcb->m_cWnd/mss;
     double_t X = mss * (cwndF + (rtts-1)/2) * rtts;
@@ -284,48 +400,36 @@ MpQuicScheduler::Blest() //only allow two subflows
   }
   
   tosend[m_lastUsedPathId] = 1.0;
-  return tosend;
 }
 
 
-std::vector<double>
-MpQuicScheduler::Ecf() //only allow two subflows
+void
+MpQuicScheduler::Ecf(std::vector<double> &tosend)
 {
   NS_LOG_FUNCTION (this);
-  std::vector<double> tosend(m_subflows.size(), 0.0);
+  tosend.assign (m_subflows.size (), 0.0);
   if (m_subflows.size() <= 1){
     m_lastUsedPathId = 0;
     tosend[m_lastUsedPathId] = 1.0;
-    return tosend;
+    return;
   }
 
-  if (m_subflows[1]->m_tcb->m_lastRtt.Get().GetSeconds() == 0) {
+  if (GetUnprobedPath () < m_subflows.size ()) {
     m_lastUsedPathId = (m_lastUsedPathId + 1) % m_subflows.size();
     tosend[m_lastUsedPathId] = 1.0;
-    return tosend;
+    return;
   } 
   
-  
-  Time rttS;
-  Time rttF;
-  uint8_t fastPathId = 1;
-  uint8_t slowPathId = 0;
-
-  if (m_subflows[0]->m_tcb->m_lastRtt > m_subflows[1]->m_tcb->m_lastRtt){
-    rttS = m_subflows[0]->m_tcb->m_lastRtt;
-    rttF = m_subflows[1]->m_tcb->m_lastRtt;
-    slowPathId = 0;
-    fastPathId = 1;
-  } else {
-    rttS = m_subflows[1]->m_tcb->m_lastRtt;
-    rttF = m_subflows[0]->m_tcb->m_lastRtt;
-    slowPathId = 1;
-    fastPathId = 0;
-  }
+  RankPathsByRtt (false);
+  uint8_t fastPathId = m_rttOrder[0];
 
   if (m_socket->AvailableWindow (fastPathId) > 0){
     m_lastUsedPathId = fastPathId;
   }else {
+    // the best alternative is the fastest other path that can send
+    uint8_t slowPathId = GetFastestAvailablePath (1);
+    Time rttS = m_subflows[slowPathId]->m_tcb->m_lastRtt;
+    Time rttF = m_subflows[fastPathId]->m_tcb->m_lastRtt;
     uint32_t k = m_socket->GetBytesInBuffer();
     double n = 1 + k/m_subflows[fastPathId]->m_tcb->m_cWnd.Get();
     double delta = max(m_subflows[fastPathId]->m_tcb->m_rttVar.GetSeconds(),m_subflows[slowPathId]->m_tcb->m_rttVar.GetSeconds());
@@ -334,7 +438,7 @@ MpQuicScheduler::Ecf() //only allow two subflows
         m_waiting = 1;
         m_lastUsedPathId = fastPathId;
         tosend[m_lastUsedPathId] = 1.0;
-        return tosend;
+        return;
       } else {
         m_lastUsedPathId = slowPathId;
       }
@@ -345,71 +449,99 @@ MpQuicScheduler::Ecf() //only allow two subflows
   }  
 
   tosend[m_lastUsedPathId] = 1.0;
-  return tosend;
 }
 
-std::vector<double>
-MpQuicScheduler::Peekaboo()
+void
+MpQuicScheduler::ResizePeekaboo (uint8_t numPaths)
+{
+  NS_LOG_FUNCTION (this << (uint16_t) numPaths);
+  NS_ABORT_MSG_IF (numPaths > PEEKABOO_MAX_PATHS,
+                   "Peekaboo supports up to " << (uint16_t) PEEKABOO_MAX_PATHS << " paths");
+  // three context features per path
+  uint32_t dim = 3 * numPaths;
+  uint32_t oldDim = peek_x.size ();
+  if (dim > oldDim)
+    {
+      uint32_t added = dim - oldDim;
+      peek_x.conservativeResize (dim);
+      peek_x.tail (added).setZero ();
+      for (uint8_t i = 0; i < Ainv.size (); i++)
+        {
+          // the new block of the design matrix is the identity, and so is its inverse
+          Ainv[i].conservativeResize (dim, dim);
+          Ainv[i].rightCols (added).setZero ();
+          Ainv[i].bottomRows (added).setZero ();
+          Ainv[i].bottomRightCorner (added, added).setIdentity ();
+          b[i].conservativeResize (dim);
+          b[i].tail (added).setZero ();
+        }
+    }
+  while (EPR.size () < numPaths)
+    {
+      EPR.push_back (0.0);
+      Ainv.push_back (PeekabooMatrix::Identity (peek_x.size (), peek_x.size ()));
+      b.push_back (PeekabooVector::Zero (peek_x.size ()));
+    }
+  if (rtt.size () < numPaths)
+    {
+      rtt.resize (numPaths, 0);
+    }
+}
+
+void
+MpQuicScheduler::Peekaboo(std::vector<double> &tosend)
 {
   NS_LOG_FUNCTION (this);
-  uint8_t K = m_subflows.size();
-  if(EPR.size() < K)
-  {
-    EPR.push_back(0.0);
-    A.push_back(MatrixXd::Identity(6,6));
-    b.push_back(VectorXd::Constant(6,0));
-  }
-  std::vector<double> tosend(m_subflows.size(), 0.0);
+  ResizePeekaboo (m_subflows.size ());
+  tosend.assign (m_subflows.size (), 0.0);
 
   if (m_subflows.size() <= 1){
     m_lastUsedPathId = 0;
     tosend[m_lastUsedPathId] = 1.0;
-    return tosend;
+    return;
   }
-  if (m_subflows[1]->m_tcb->m_lastRtt.Get().GetSeconds() == 0) {
-    m_lastUsedPathId = 1;
+
+  uint8_t unprobedPathId = GetUnprobedPath ();
+  if (unprobedPathId < m_subflows.size ()) {
+    m_lastUsedPathId = unprobedPathId;
     tosend[m_lastUsedPathId] = 1.0;
-    return tosend;
+    return;
   }
 
-  Time rttS;
-  Time rttF;
-  uint8_t fastPathId = 1;
-  uint8_t slowPathId = 0;
-
-  if (m_subflows[0]->m_tcb->m_lastRtt >= m_subflows[1]->m_tcb->m_lastRtt){
-    rttS = m_subflows[0]->m_tcb->m_lastRtt;
-    rttF = m_subflows[1]->m_tcb->m_lastRtt;
-    slowPathId = 0;
-    fastPathId = 1;
-  } else {
-    rttS = m_subflows[1]->m_tcb->m_lastRtt;
-    rttF = m_subflows[0]->m_tcb->m_lastRtt;
-    slowPathId = 1;
-    fastPathId = 0;
-  }
+  RankPathsByRtt (true);
+  uint8_t fastPathId = m_rttOrder[0];
 
   if (m_socket->AvailableWindow (fastPathId) > 0){
     m_lastUsedPathId = fastPathId;
   }else {
-    for (int i = 0; i < 2; i++){
-      MatrixXd zeta = A[i]*b[i];
-      EPR[i] = (peek_x.transpose() * zeta).value() + 0.8 * std::sqrt(peek_x.transpose() * A[i].inverse() * peek_x);
+    // the best alternative is the fastest other path that can send
+    uint8_t slowPathId = GetFastestAvailablePath (1);
+    PeekabooVector zeta;
+    PeekabooVector ainvX[2];
+    uint8_t candidates[2] = {fastPathId, slowPathId};
+    for (uint8_t c = 0; c < 2; c++){
+      uint8_t i = candidates[c];
+      zeta.noalias () = Ainv[i] * b[i];
+      ainvX[c].noalias () = Ainv[i] * peek_x;
+      EPR[i] = peek_x.dot (zeta) + 0.8 * std::sqrt (peek_x.dot (ainvX[c]));
     }
 
+    uint8_t chosen;
     if(EPR[fastPathId] > EPR[slowPathId]){
-      m_lastUsedPathId = fastPathId; //wait
+      chosen = 0; //wait
     } else {
-      m_lastUsedPathId = slowPathId; //transmit on slow path
+      chosen = 1; //transmit on slow path
     }
+    m_lastUsedPathId = candidates[chosen];
 
-    A[m_lastUsedPathId] = A[m_lastUsedPathId] + peek_x * peek_x.transpose();
-    b[m_lastUsedPathId] = b[m_lastUsedPathId] + R * peek_x;
+    // Sherman-Morrison update of the inverse for the rank-1 update of the design matrix
+    Ainv[m_lastUsedPathId].noalias () -= ainvX[chosen] * ainvX[chosen].transpose ()
+                                         / (1 + peek_x.dot (ainvX[chosen]));
+    b[m_lastUsedPathId] += R * peek_x;
 
   }
 
   tosend[m_lastUsedPathId] = 1.0;
-  return tosend;
 
 }
 
@@ -418,23 +550,24 @@ void
 MpQuicScheduler::PeekabooReward(uint8_t pathId, Time lastActTime)
 {
   NS_LOG_FUNCTION (this);
+  if (m_schedulerType != PEEKABOO)
+    {
+      return;
+    }
+  ResizePeekaboo (std::max<uint8_t> (m_subflows.size (), pathId + 1));
   
   rtt[pathId] = m_subflows[pathId]->m_tcb->m_lastRtt.Get().GetDouble();
-  if (rtt[0]==0) rtt[0] = 10;     // initialize rtt0 with 20ms
-  if (rtt[1]==0) rtt[1] = 10;     // initialize rtt0 with 20ms
-  if(pathId == 0){
-    peek_x[0] = m_subflows[pathId]->m_tcb->m_cWnd.Get()/rtt[pathId];
-    peek_x[1] = m_subflows[pathId]->m_tcb->m_bytesInFlight.Get()/rtt[pathId];
-    peek_x[2] = m_subflows[pathId]->m_tcb->m_cWnd.Get()/rtt[pathId];
-  } else{
-    peek_x[3] = m_subflows[pathId]->m_tcb->m_cWnd.Get()/rtt[pathId];
-    peek_x[4] = m_subflows[pathId]->m_tcb->m_bytesInFlight.Get()/rtt[pathId];
-    peek_x[5] = m_subflows[pathId]->m_tcb->m_cWnd.Get()/rtt[pathId];
-  }
+  for (uint8_t i = 0; i < rtt.size (); i++)
+    {
+      if (rtt[i] == 0) rtt[i] = 10;     // initialize rtt with 20ms
+    }
+  peek_x[3 * pathId] = m_subflows[pathId]->m_tcb->m_cWnd.Get()/rtt[pathId];
+  peek_x[3 * pathId + 1] = m_subflows[pathId]->m_tcb->m_bytesInFlight.Get()/rtt[pathId];
+  peek_x[3 * pathId + 2] = m_subflows[pathId]->m_tcb->m_cWnd.Get()/rtt[pathId];
 
 
-  double rtt_f = std::min(rtt[0], rtt[1]);
-  double rtt_s = std::max(rtt[0], rtt[1]);
+  double rtt_f = *std::min_element (rtt.begin (), rtt.end ());
+  double rtt_s = *std::max_element (rtt.begin (), rtt.end ());
 
   T_r = std::max(2*rtt_f, rtt_s);
   T_e = (Now () - lastActTime).GetMilliSeconds();
@@ -460,11 +593,11 @@ MpQuicScheduler::PeekabooReward(uint8_t pathId, Time lastActTime)
 }
 
 
-std::vector<double>
-MpQuicScheduler::MabDelay()
+void
+MpQuicScheduler::MabDelay(std::vector<double> &tosend)
 {
   NS_LOG_FUNCTION (this);
-  std::vector<double> tosend(m_subflows.size(), 0.0);
+  tosend.assign (m_subflows.size (), 0.0);
   m_rounds++;
   uint8_t K = m_subflows.size();
   if(m_cost.size() < K)
@@ -485,21 +618,20 @@ MpQuicScheduler::MabDelay()
   {
     m_lastUsedPathId = 0;
     tosend[m_lastUsedPathId] = 1.0;
-    return tosend;
+    return;
   }
 
   
   if (m_p[0] == 1.0/K)
   {
-    Ptr<UniformRandomVariable> x = CreateObject<UniformRandomVariable> ();
-    m_lastUsedPathId = x->GetInteger (0,K-1);
+    m_lastUsedPathId = m_uniform->GetInteger (0,K-1);
   }
   else
   {
     m_lastUsedPathId = std::max_element(m_p.begin(),m_p.end()) - m_p.begin();
   }
   
-  return m_p;
+  tosend = m_p;
 }
 
 
@@ -554,15 +686,15 @@ MpQuicScheduler::GetCurrentRound()
 }
 
 
-std::vector<double>
-MpQuicScheduler::LocalOpt()
+void
+MpQuicScheduler::LocalOpt(std::vector<double> &tosend)
 {
   NS_LOG_FUNCTION (this);
-  std::vector<double> tosend(m_subflows.size(), 0.0);
+  tosend.assign (m_subflows.size (), 0.0);
   if (m_subflows.size() < 2){
     m_lastUsedPathId = 0;
     tosend[m_lastUsedPathId] = 1.0;
-    return tosend;
+    return;
   }
   bitset<12> binary(m_select);
 
@@ -576,7 +708,6 @@ MpQuicScheduler::LocalOpt()
   m_rounds++;
 
   tosend[m_lastUsedPathId] = 1.0;
-  return tosend;
 }
 
 
@@ -24,6 +24,7 @@
 
 #include "ns3/node.h"
 #include "quic-socket-base.h"
+#include "ns3/random-variable-stream.h"
 #include <eigen3/Eigen/Dense>
 using Eigen::MatrixXd;
 using Eigen::VectorXd;
@@ -41,7 +42,8 @@ public:
       BLEST,
       ECF,
       PEEKABOO,
-      MAB_DELAY
+      MAB_DELAY,
+      DEADLINE
     } SchedulerType_t;
   
   /**
@@ -54,7 +56,26 @@ public:
   MpQuicScheduler (void);
   virtual ~MpQuicScheduler (void);
 
-  std::vector<double> GetNextPathIdToUse();
+  /**
+   * \brief Decide how the pending data is split among the active paths
+   *
+   * The weights are written into a vector owned by the caller, which is
+   * expected to reuse it across calls so that no allocation is needed once
+   * its capacity matches the number of paths.
+   *
+   * \param tosend the fraction of the pending data to send on each path
+   */
+  void GetNextPathIdToUse (std::vector<double> &tosend);
+
+  /**
+   * \brief Check if the path is chosen for each packet rather than for each burst
+   *
+   * The DEADLINE scheduler picks the path from the deadline of the frame at
+   * the head of the buffer, so it must run again before each packet.
+   *
+   * \return true if GetNextPathIdToUse must be called before each packet
+   */
+  bool IsPerPacket () const;
   void SetSocket(Ptr<QuicSocketBase> sock);
     
   void UpdateReward (uint32_t oldValue, uint32_t newValue);
@@ -64,22 +85,66 @@ public:
 
   void PeekabooReward(uint8_t pathId, Time lastActTime);
 
+  /**
+   * \brief Estimate how long a frame sent now takes to reach the receiver on a path
+   *
+   * The estimate is half the smoothed RTT, plus the time the frame waits for
+   * room in the congestion window given the data in flight.
+   *
+   * \param tcb the congestion state of the path
+   * \return the estimated delivery delay
+   */
+  static Time EstimateDeliveryTime (Ptr<const QuicSocketState> tcb);
+
 private:
   Ptr<QuicSocketBase> m_socket;
   uint8_t m_lastUsedPathId;
   
   
   std::vector <Ptr<MpQuicSubFlow>> m_subflows;
+  uint32_t m_subflowsVersion;           //!< Version of the socket's active subflows copied in m_subflows
   SchedulerType_t m_schedulerType;
+  std::vector<uint8_t> m_rttOrder;      //!< Active path IDs sorted by increasing RTT
+  std::vector<Time> m_deliveryTimes;    //!< Estimated delivery delay of each active path, used by DEADLINE
+
 
+  void RoundRobin(std::vector<double> &tosend);
+  void MinRtt(std::vector<double> &tosend);
+  void Peekaboo(std::vector<double> &tosend);
+  void MabDelay(std::vector<double> &tosend);
+  void Blest(std::vector<double> &tosend);
+  void Ecf(std::vector<double> &tosend);
+  void LocalOpt(std::vector<double> &tosend);
+  void Deadline(std::vector<double> &tosend);
 
-  std::vector<double> RoundRobin();
-  std::vector<double> MinRtt();
-  std::vector<double> Peekaboo();
-  std::vector<double> MabDelay();
-  std::vector<double> Blest();
-  std::vector<double> Ecf();
-  std::vector<double> LocalOpt();
+  /**
+   * \brief Sort the active paths by increasing RTT into m_rttOrder
+   *
+   * \param preferHigherId break ties in favour of the higher path ID
+   */
+  void RankPathsByRtt (bool preferHigherId);
+
+  /**
+   * \brief Find an active path without an RTT sample
+   *
+   * \return the lowest such path ID, or the number of active paths if all have been sampled
+   */
+  uint8_t GetUnprobedPath () const;
+
+  /**
+   * \brief Find the fastest path with room in its congestion window
+   *
+   * \param from the first position in m_rttOrder to consider
+   * \return the path ID, or the slowest path if no path has room
+   */
+  uint8_t GetFastestAvailablePath (uint8_t from);
+
+  /**
+   * \brief Grow the Peekaboo context and the per-path models to a number of paths
+   *
+   * \param numPaths the number of paths
+   */
+  void ResizePeekaboo (uint8_t numPaths);
 
   std::vector <uint64_t> m_rewards;
   std::vector <uint64_t> m_rewardTemp;
@@ -102,12 +167,20 @@ private:
   std::vector <double> m_L;
   std::vector <double> m_eL;
   std::vector <double> m_p;
+  Ptr<UniformRandomVariable> m_uniform;  //!< Random path choice of MAB_DELAY
+  static const uint8_t PEEKABOO_MAX_PATHS = 8;     //!< Largest number of paths handled by Peekaboo
+  /// Peekaboo matrix, stored inline up to the context size of PEEKABOO_MAX_PATHS paths
+  typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, 0,
+                        3 * PEEKABOO_MAX_PATHS, 3 * PEEKABOO_MAX_PATHS> PeekabooMatrix;
+  /// Peekaboo vector, stored inline up to the context size of PEEKABOO_MAX_PATHS paths
+  typedef Eigen::Matrix<double, Eigen::Dynamic, 1, 0, 3 * PEEKABOO_MAX_PATHS, 1> PeekabooVector;
+
   std::vector <double> EPR;
-  std::vector <MatrixXd> A;
-  std::vector <VectorXd> b;
-  VectorXd peek_x = VectorXd::Constant(6,0);
+  std::vector <PeekabooMatrix, Eigen::aligned_allocator<PeekabooMatrix> > Ainv;  //!< Inverse of the design matrix, kept with Sherman-Morrison updates
+  std::vector <PeekabooVector, Eigen::aligned_allocator<PeekabooVector> > b;
+  PeekabooVector peek_x;
   double T_r, g = 1, R = 0, T_e;
-  double rtt[8];
+  std::vector <double> rtt;
 };
 
 } // namespace ns3
@@ -46,6 +46,97 @@ namespace ns3 {
 
 NS_OBJECT_ENSURE_REGISTERED (MpQuicSubFlow);
 
+MpQuicReceivedPacketSet::MpQuicReceivedPacketSet ()
+{
+}
+
+bool
+MpQuicReceivedPacketSet::Add (SequenceNumber32 seq)
+{
+  // First range starting after seq
+  auto next = m_ranges.upper_bound (seq);
+  bool mergeNext = (next != m_ranges.end () && next->first == seq + 1);
+
+  if (next != m_ranges.begin ())
+    {
+      auto prev = std::prev (next);
+      if (seq <= prev->second)
+        {
+          return false;
+        }
+      if (prev->second + 1 == seq)
+        {
+          prev->second = seq;
+          if (mergeNext)
+            {
+              prev->second = next->second;
+              m_ranges.erase (next);
+            }
+          return true;
+        }
+    }
+
+  if (mergeNext)
+    {
+      SequenceNumber32 last = next->second;
+      next = m_ranges.erase (next);
+      m_ranges.insert (next, std::make_pair (seq, last));
+      return true;
+    }
+
+  m_ranges.insert (next, std::make_pair (seq, seq));
+  return true;
+}
+
+bool
+MpQuicReceivedPacketSet::IsEmpty () const
+{
+  return m_ranges.empty ();
+}
+
+SequenceNumber32
+MpQuicReceivedPacketSet::GetLargest () const
+{
+  NS_ASSERT_MSG (!m_ranges.empty (), "No packet received");
+  return m_ranges.rbegin ()->second;
+}
+
+void
+MpQuicReceivedPacketSet::GetAckBlocks (uint32_t maxGaps, QuicAckBlockList &gaps,
+                                       QuicAckBlockList &additionalAckBlocks) const
+{
+  if (m_ranges.empty ())
+    {
+      return;
+    }
+
+  auto curr = m_ranges.rbegin ();
+  for (auto next = std::next (curr); next != m_ranges.rend () && gaps.size () < maxGaps;
+       ++curr, ++next)
+    {
+      additionalAckBlocks.push_back (next->second.GetValue ());
+      gaps.push_back (curr->first.GetValue () - 1);
+    }
+}
+
+void
+MpQuicReceivedPacketSet::Trim (uint32_t maxGaps)
+{
+  while (m_ranges.size () > 1 && m_ranges.size () - 1 > maxGaps)
+    {
+      auto oldest = m_ranges.begin ();
+      auto next = std::next (oldest);
+      oldest->second = next->second;
+      m_ranges.erase (next);
+    }
+}
+
+uint32_t
+MpQuicReceivedPacketSet::GetRangeCount () const
+{
+  return m_ranges.size ();
+}
+
 
 TypeId
 MpQuicSubFlow::GetTypeId (void)
@@ -65,12 +156,15 @@ MpQuicSubFlow::MpQuicSubFlow()
     : m_flowId (0),
       m_lastMaxData(0),
       m_maxDataInterval(10),
+      m_pacingBurst(0),
+      m_pacingTokens(0),
+      m_lastPacingRefill(Seconds (0)),
       m_rounds(1)
 {
 
     m_numPacketsReceivedSinceLastAckSent = 0;
     m_queue_ack = false;
-    m_receivedPacketNumbers = std::vector<SequenceNumber32> ();
+    m_receivedPacketNumbers = MpQuicReceivedPacketSet ();
 
     //For congestion control
     m_tcb = CreateObject<QuicSocketState> ();
@@ -86,6 +180,35 @@ MpQuicSubFlow::MpQuicSubFlow()
 
 }
 
+MpQuicSubFlow::MpQuicSubFlow (const MpQuicSubFlow &other)
+    : Object (other),
+      m_flowId (other.m_flowId),
+      m_localAddr (other.m_localAddr),
+      m_peerAddr (other.m_peerAddr),
+      m_subflowState (other.m_subflowState),
+      m_rto (other.m_rto),
+      m_drainingPeriodTimeout (other.m_drainingPeriodTimeout),
+      m_flushOnClose (other.m_flushOnClose),
+      m_closeOnEmpty (other.m_closeOnEmpty),
+      m_queue_ack (other.m_queue_ack),
+      m_numPacketsReceivedSinceLastAckSent (other.m_numPacketsReceivedSinceLastAckSent),
+      m_lastMaxData (other.m_lastMaxData),
+      m_maxDataInterval (other.m_maxDataInterval),
+      m_pacingBurst (other.m_pacingBurst),
+      m_pacingTokens (other.m_pacingTokens),
+      m_lastPacingRefill (other.m_lastPacingRefill),
+      m_receivedPacketNumbers (other.m_receivedPacketNumbers),
+      m_rounds (other.m_rounds)
+{
+    NS_LOG_FUNCTION (this);
+
+    m_tcb = CopyObject (other.m_tcb);
+    bool ok;
+    ok = m_tcb->TraceConnectWithoutContext ("CongestionWindow",
+                                            MakeCallback (&MpQuicSubFlow::UpdateCwnd, this));
+    NS_ASSERT_MSG (ok == true, "Failed connection to CWND trace");
+}
+
 MpQuicSubFlow::~MpQuicSubFlow()
 {
     m_flowId     = 0;
@@ -101,6 +224,9 @@ MpQuicSubFlow::SetSegSize (uint32_t size)
   m_tcb->m_segmentSize = size;
   m_tcb->m_initialCWnd = 2 * size;
   m_tcb->m_kMinimumWindow = 2 * size;
+  // allow a burst of two segments, as the initial quantum of the fq qdisc
+  m_pacingBurst = 2 * size;
+  m_pacingTokens = m_pacingBurst;
 }
 
 uint32_t
@@ -124,5 +250,45 @@ MpQuicSubFlow::UpdateCwnd (uint32_t oldValue, uint32_t newValue)
   m_cWndTrace (oldValue, newValue);
 }
 
+void
+MpQuicSubFlow::RefillPacingTokens ()
+{
+  Time now = Simulator::Now ();
+  double rate = m_tcb->m_pacingRate.Get ().GetBitRate () / 8.0;
+  m_pacingTokens = std::min<double> (m_pacingBurst,
+                                     m_pacingTokens + rate * (now - m_lastPacingRefill).GetSeconds ());
+  m_lastPacingRefill = now;
+}
+
+bool
+MpQuicSubFlow::PacingAllowsSend ()
+{
+  NS_LOG_FUNCTION (this);
+  if (m_pacingTimer.IsRunning ())
+    {
+      return false;
+    }
+  RefillPacingTokens ();
+  NS_LOG_DEBUG ("Pacing tokens " << m_pacingTokens << " on path " << m_flowId);
+  return m_pacingTokens > 0;
+}
+
+void
+MpQuicSubFlow::ConsumePacingTokens (uint32_t size)
+{
+  NS_LOG_FUNCTION (this << size);
+  RefillPacingTokens ();
+  m_pacingTokens -= size;
+
+  if (m_pacingTokens <= 0 and !m_pacingTimer.IsRunning ())
+    {
+      // wake up when a byte of tokens is available again
+      uint32_t deficit = std::ceil (-m_pacingTokens) + 1;
+      Time delay = m_tcb->m_pacingRate.Get ().CalculateBytesTxTime (deficit);
+      NS_LOG_DEBUG ("Pacing bucket empty on path " << m_flowId << ", expires in " << delay);
+      m_pacingTimer.Schedule (delay);
+    }
+}
+
 
 } // namespace ns3
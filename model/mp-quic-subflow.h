@@ -44,6 +44,70 @@ using namespace std;
 
 namespace ns3 {
 
+/**
+ * \ingroup quic
+ *
+ * \brief Packet numbers received on a subflow, kept as disjoint ranges
+ *
+ * The ranges are used to build the ACK blocks and gaps of the ACK frames
+ * sent on the subflow
+ */
+class MpQuicReceivedPacketSet
+{
+public:
+  MpQuicReceivedPacketSet ();
+
+  /**
+   * \brief Add a received packet number
+   *
+   * \param seq the packet number
+   * \return false if the packet number was already received
+   */
+  bool Add (SequenceNumber32 seq);
+
+  /**
+   * \return true if no packet number was received
+   */
+  bool IsEmpty () const;
+
+  /**
+   * \return the largest received packet number
+   */
+  SequenceNumber32 GetLargest () const;
+
+  /**
+   * \brief Build the gaps and the additional ACK blocks of an ACK frame
+   *
+   * Starting from the largest received packet, each gap holds the packet number
+   * before a range and each block the largest packet number of the next
+   * (lower) range. The last block also covers all the older packets.
+   *
+   * \param maxGaps the maximum number of gaps to report
+   * \param gaps the vector to fill with the gaps
+   * \param additionalAckBlocks the vector to fill with the additional ACK blocks
+   */
+  void GetAckBlocks (uint32_t maxGaps, QuicAckBlockList &gaps,
+                     QuicAckBlockList &additionalAckBlocks) const;
+
+  /**
+   * \brief Merge the oldest ranges until at most maxGaps gaps are left
+   *
+   * Ranges beyond the last block of an ACK frame are already acknowledged by
+   * it, so merging them does not change the ACK frames
+   *
+   * \param maxGaps the maximum number of gaps to keep
+   */
+  void Trim (uint32_t maxGaps);
+
+  /**
+   * \return the number of ranges
+   */
+  uint32_t GetRangeCount () const;
+
+private:
+  std::map<SequenceNumber32, SequenceNumber32> m_ranges;  //!< Ranges of received packet numbers (first, last)
+};
+
 class MpQuicSubFlow : public Object
 {
 public:
@@ -59,6 +123,15 @@ public:
     static TypeId GetTypeId (void);
 
     MpQuicSubFlow ();
+    /**
+     * \brief Copy constructor, used when a socket is forked
+     *
+     * The congestion control state is copied, while the timers and events
+     * start idle so that the copy does not share them with the original
+     *
+     * \param other the subflow to copy
+     */
+    MpQuicSubFlow (const MpQuicSubFlow &other);
     ~MpQuicSubFlow ();
 
     uint16_t m_flowId;
@@ -74,6 +147,26 @@ public:
 
     void UpdateCwnd (uint32_t oldValue, uint32_t newValue);
 
+    /**
+     * \brief Check whether the pacing rate of the subflow allows sending now
+     *
+     * The pacing tokens earned since the last check at the current pacing
+     * rate are added to the bucket, up to m_pacingBurst bytes
+     *
+     * \return true if the bucket holds tokens
+     */
+    bool PacingAllowsSend ();
+
+    /**
+     * \brief Take the tokens of a packet sent on the subflow
+     *
+     * When the bucket is empty, the pacing timer is armed for the time needed
+     * to earn tokens again
+     *
+     * \param size the size of the packet
+     */
+    void ConsumePacingTokens (uint32_t size);
+
     // The following member parameters are moved from 'quic-socket-base.h'
     // Timers and Events
     EventId m_sendPendingDataEvent;             //!< Micro-delay event to send pending data
@@ -94,13 +187,21 @@ public:
     uint32_t m_lastMaxData;                         //!< Last MaxData ACK
     uint32_t m_maxDataInterval;                     //!< Interval between successive MaxData frames in ACKs
 
-    // Pacing timer
+    // Pacing
     Timer m_pacingTimer       {Timer::REMOVE_ON_DESTROY};   //!< Pacing Event
-    std::vector<SequenceNumber32> m_receivedPacketNumbers;  //!< Received packet number vector
+    uint32_t m_pacingBurst;                         //!< Size of the pacing token bucket (bytes)
+    double m_pacingTokens;                          //!< Pacing tokens in the bucket (bytes), negative after a burst
+    Time m_lastPacingRefill;                        //!< Last time the pacing tokens were refilled
+    MpQuicReceivedPacketSet m_receivedPacketNumbers;  //!< Received packet numbers
 
     uint32_t m_rounds;
 
 private:
+  /**
+   * \brief Add the pacing tokens earned since the last refill
+   */
+  void RefillPacingTokens ();
+
   TracedCallback<uint32_t, uint32_t> m_cWndTrace;
 
 };
@@ -0,0 +1,240 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Pan Lab, Department of Computer Science, University of Victoria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef QUIC_INLINE_VECTOR_H
+#define QUIC_INLINE_VECTOR_H
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup quic
+ *
+ * \brief Vector of trivially copyable values stored inline up to a fixed capacity
+ *
+ * The first N elements live in the object itself, so short lists (e.g., the
+ * ranges of an ACK frame) are built, copied and destroyed without going
+ * through the allocator. Longer lists move to the heap. The interface is the
+ * subset of std::vector used for such lists.
+ *
+ * \tparam T the element type
+ * \tparam N the number of elements stored inline
+ */
+template <typename T, std::size_t N>
+class QuicInlineVector
+{
+  static_assert (std::is_trivially_copyable<T>::value, "Elements must be trivially copyable");
+
+public:
+  typedef T value_type;            //!< Element type
+  typedef T * iterator;            //!< Iterator
+  typedef const T * const_iterator;  //!< Const iterator
+
+  QuicInlineVector ()
+    : m_data (m_inline),
+      m_size (0),
+      m_capacity (N)
+  {
+  }
+
+  /**
+   * \brief Build the list from a std::vector
+   *
+   * \param other the vector to copy
+   */
+  QuicInlineVector (const std::vector<T> &other)
+    : QuicInlineVector ()
+  {
+    Assign (other.data (), other.size ());
+  }
+
+  /**
+   * \brief Copy constructor
+   *
+   * \param other the list to copy
+   */
+  QuicInlineVector (const QuicInlineVector &other)
+    : QuicInlineVector ()
+  {
+    Assign (other.m_data, other.m_size);
+  }
+
+  /**
+   * \brief Copy assignment
+   *
+   * \param other the list to copy
+   * \return this list
+   */
+  QuicInlineVector & operator= (const QuicInlineVector &other)
+  {
+    if (this != &other)
+      {
+        Assign (other.m_data, other.m_size);
+      }
+    return *this;
+  }
+
+  ~QuicInlineVector ()
+  {
+    if (m_data != m_inline)
+      {
+        delete[] m_data;
+      }
+  }
+
+  /**
+   * \return the number of elements
+   */
+  std::size_t size () const
+  {
+    return m_size;
+  }
+
+  /**
+   * \return true if the list has no elements
+   */
+  bool empty () const
+  {
+    return m_size == 0;
+  }
+
+  /**
+   * \brief Remove all the elements, keeping the storage
+   */
+  void clear ()
+  {
+    m_size = 0;
+  }
+
+  /**
+   * \brief Append an element
+   *
+   * \param value the element
+   */
+  void push_back (const T &value)
+  {
+    if (m_size == m_capacity)
+      {
+        Grow (2 * m_capacity);
+      }
+    m_data[m_size++] = value;
+  }
+
+  /**
+   * \brief Remove the last element
+   */
+  void pop_back ()
+  {
+    --m_size;
+  }
+
+  /**
+   * \param i the index
+   * \return the element at index i
+   */
+  T & operator[] (std::size_t i)
+  {
+    return m_data[i];
+  }
+
+  /**
+   * \param i the index
+   * \return the element at index i
+   */
+  const T & operator[] (std::size_t i) const
+  {
+    return m_data[i];
+  }
+
+  /**
+   * \return the last element
+   */
+  const T & back () const
+  {
+    return m_data[m_size - 1];
+  }
+
+  iterator begin ()
+  {
+    return m_data;
+  }
+
+  iterator end ()
+  {
+    return m_data + m_size;
+  }
+
+  const_iterator begin () const
+  {
+    return m_data;
+  }
+
+  const_iterator end () const
+  {
+    return m_data + m_size;
+  }
+
+private:
+  /**
+   * \brief Replace the content of the list
+   *
+   * \param data the elements to copy
+   * \param size the number of elements
+   */
+  void Assign (const T *data, std::size_t size)
+  {
+    m_size = 0;
+    if (size > m_capacity)
+      {
+        Grow (size);
+      }
+    std::copy (data, data + size, m_data);
+    m_size = size;
+  }
+
+  /**
+   * \brief Move the elements to a heap array
+   *
+   * \param capacity the new capacity
+   */
+  void Grow (std::size_t capacity)
+  {
+    T *data = new T[capacity];
+    std::copy (m_data, m_data + m_size, data);
+    if (m_data != m_inline)
+      {
+        delete[] m_data;
+      }
+    m_data = data;
+    m_capacity = capacity;
+  }
+
+  T m_inline[N];           //!< Inline storage
+  T *m_data;               //!< Current storage, inline or on the heap
+  std::size_t m_size;      //!< Number of elements
+  std::size_t m_capacity;  //!< Capacity of the current storage
+};
+
+} // namespace ns3
+
+#endif /* QUIC_INLINE_VECTOR_H */
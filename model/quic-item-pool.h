@@ -0,0 +1,104 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Pan Lab, Department of Computer Science, University of Victoria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef QUIC_ITEM_POOL_H
+#define QUIC_ITEM_POOL_H
+
+#include <cstddef>
+#include <new>
+
+namespace ns3 {
+
+/**
+ * \ingroup quic
+ *
+ * \brief Free list recycling the memory of fixed-size bookkeeping items
+ *
+ * A class uses the pool by forwarding its own operator new and operator
+ * delete to Allocate and Release. Released blocks are chained through their
+ * own memory and handed out again by the next allocation, so items that are
+ * created and destroyed for every packet do not go through the global
+ * allocator in steady state. Allocations of a different size (e.g., from a
+ * derived class) are passed to the global allocator.
+ *
+ * \tparam T the pooled class
+ */
+template <typename T>
+class QuicItemPool
+{
+public:
+  /**
+   * \brief Get a block of memory for an item
+   *
+   * \param size the requested size
+   * \return the block
+   */
+  static void * Allocate (std::size_t size)
+  {
+    if (size != sizeof (T) || m_head == nullptr)
+      {
+        return ::operator new (size);
+      }
+    FreeBlock *block = m_head;
+    m_head = block->m_next;
+    return block;
+  }
+
+  /**
+   * \brief Return the block of a destroyed item to the pool
+   *
+   * \param p the block
+   * \param size the size of the block
+   */
+  static void Release (void *p, std::size_t size)
+  {
+    if (p == nullptr)
+      {
+        return;
+      }
+    if (size != sizeof (T))
+      {
+        ::operator delete (p);
+        return;
+      }
+    FreeBlock *block = static_cast<FreeBlock *> (p);
+    block->m_next = m_head;
+    m_head = block;
+  }
+
+private:
+  /**
+   * \brief A released block, linked to the next free one
+   */
+  struct FreeBlock
+  {
+    FreeBlock *m_next;  //!< Next free block
+  };
+
+  static_assert (sizeof (T) >= sizeof (FreeBlock), "Item too small to be pooled");
+
+  static FreeBlock *m_head;  //!< First free block
+};
+
+template <typename T>
+typename QuicItemPool<T>::FreeBlock *QuicItemPool<T>::m_head = nullptr;
+
+} // namespace ns3
+
+#endif /* QUIC_ITEM_POOL_H */
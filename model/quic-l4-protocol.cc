@@ -26,6 +26,7 @@
 #include "ns3/assert.h"
 #include "ns3/log.h"
 #include "ns3/nstime.h"
+#include "ns3/uinteger.h"
 #include "ns3/boolean.h"
 #include "ns3/object-vector.h"
 #include "ns3/pointer.h"
@@ -140,6 +141,22 @@ QuicL4Protocol::GetTypeId (void)
                    ObjectVectorValue (),
                    MakeObjectVectorAccessor (&QuicL4Protocol::m_quicUdpBindingList),
                    MakeObjectVectorChecker<QuicUdpBinding> ())
+    .AddAttribute ("AuthAddressTimeout",
+                   "Time after which an unused authenticated address expires (0 to never expire).",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&QuicL4Protocol::m_authAddressTimeout),
+                   MakeTimeChecker ())
+    .AddAttribute ("MaxAuthAddresses",
+                   "Max number of authenticated addresses, the least recently used is removed first (0 for no limit).",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&QuicL4Protocol::m_maxAuthAddresses),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("BatchedReceive",
+                   "Drain all the datagrams queued on a UDP socket before delivering them, "
+                   "so that each QUIC socket processes them as a batch.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&QuicL4Protocol::m_batchedReceive),
+                   MakeBooleanChecker ())
     /*.AddAttribute ("AuthAddresses", "The list of Authenticated addresses associated to this protocol.",
                                            ObjectVectorValue (),
                                            MakeObjectVectorAccessor (&QuicL4Protocol::m_authAddresses),
@@ -151,6 +168,9 @@ QuicL4Protocol::GetTypeId (void)
 QuicL4Protocol::QuicL4Protocol ()
   : m_node (0),
   m_0RTTHandshakeStart (false),
+  m_authAddressTimeout (Seconds (0)),
+  m_maxAuthAddresses (0),
+  m_batchedReceive (false),
   m_isServer (false),
   m_endPoints (new Ipv4EndPointDemux ()),
   m_endPoints6 (new Ipv6EndPointDemux ())
@@ -165,6 +185,8 @@ QuicL4Protocol::~QuicL4Protocol ()
 {
   NS_LOG_FUNCTION (this);
   m_quicUdpBindingList.clear ();
+  m_connectionIndex.clear ();
+  m_pathIndex.clear ();
 }
 
 void
@@ -414,6 +436,7 @@ QuicL4Protocol::SetListener (Ptr<QuicSocketBase> sock)
       m_isServer = true;
       m_quicUdpBindingList.front ()->m_quicSocket = sock;
       m_quicUdpBindingList.front ()->m_listenerBinding = true;
+      RebuildIndexes ();
       return true;
     }
 
@@ -426,10 +449,75 @@ QuicL4Protocol::IsServer (void)  const
   return m_isServer;
 }
 
-const std::vector<Address>&
+std::vector<Address>
 QuicL4Protocol::GetAuthAddresses () const
 {
-  return m_authAddresses;
+  std::vector<Address> addresses;
+  addresses.reserve (m_authAddressList.size ());
+  for (auto it = m_authAddressList.begin (); it != m_authAddressList.end (); ++it)
+    {
+      addresses.push_back (it->first);
+    }
+  return addresses;
+}
+
+void
+QuicL4Protocol::AddAuthAddress (Ipv4Address address)
+{
+  NS_LOG_FUNCTION (this << address);
+
+  ExpireAuthAddresses ();
+  auto found = m_authAddresses.find (address);
+  if (found != m_authAddresses.end ())
+    {
+      found->second->second = Simulator::Now ();
+      m_authAddressList.splice (m_authAddressList.begin (), m_authAddressList, found->second);
+      return;
+    }
+
+  m_authAddressList.push_front (std::make_pair (address, Simulator::Now ()));
+  m_authAddresses[address] = m_authAddressList.begin ();
+
+  if (m_maxAuthAddresses > 0 and m_authAddressList.size () > m_maxAuthAddresses)
+    {
+      NS_LOG_LOGIC (this << " Removing least recently used authenticated address " << m_authAddressList.back ().first);
+      m_authAddresses.erase (m_authAddressList.back ().first);
+      m_authAddressList.pop_back ();
+    }
+}
+
+bool
+QuicL4Protocol::IsAuthAddress (Ipv4Address address)
+{
+  NS_LOG_FUNCTION (this << address);
+
+  ExpireAuthAddresses ();
+  auto found = m_authAddresses.find (address);
+  if (found == m_authAddresses.end ())
+    {
+      return false;
+    }
+
+  found->second->second = Simulator::Now ();
+  m_authAddressList.splice (m_authAddressList.begin (), m_authAddressList, found->second);
+  return true;
+}
+
+void
+QuicL4Protocol::ExpireAuthAddresses ()
+{
+  if (m_authAddressTimeout.IsZero ())
+    {
+      return;
+    }
+
+  Time oldest = Simulator::Now () - m_authAddressTimeout;
+  while (!m_authAddressList.empty () and m_authAddressList.back ().second < oldest)
+    {
+      NS_LOG_LOGIC (this << " Authenticated address " << m_authAddressList.back ().first << " expired");
+      m_authAddresses.erase (m_authAddressList.back ().first);
+      m_authAddressList.pop_back ();
+    }
 }
 
 void
@@ -488,16 +576,11 @@ QuicL4Protocol::ForwardUp (Ptr<Socket> sock)
                           " if source and destination IP address and port are sufficient to identify a connection");
         }
 
-      QuicUdpBindingList::iterator it;
       Ptr<QuicSocketBase> socket;
-      for (it = m_quicUdpBindingList.begin (); it != m_quicUdpBindingList.end (); ++it)
+      auto conn = m_connectionIndex.find (connectionId);
+      if (conn != m_connectionIndex.end ())
         {
-          Ptr<QuicUdpBinding> item = *it;
-          if (item->m_quicSocket->GetConnectionId () == connectionId)
-            {
-              socket = item->m_quicSocket;
-              break;
-            }
+          socket = conn->second;
         }
 
       NS_LOG_LOGIC ((socket == nullptr));
@@ -512,7 +595,7 @@ QuicL4Protocol::ForwardUp (Ptr<Socket> sock)
         {
           NS_LOG_LOGIC (this << " Cloning listening socket " << m_quicUdpBindingList.front ()->m_quicSocket);
           socket = CloneSocket (m_quicUdpBindingList.front ()->m_quicSocket);
-          socket->SetConnectionId (connectionId);
+          UpdateConnectionId (socket, connectionId);
           socket->Connect (from);
           socket->SetupCallback ();
 
@@ -521,23 +604,23 @@ QuicL4Protocol::ForwardUp (Ptr<Socket> sock)
         {
           NS_LOG_LOGIC ("CONNECTION AUTHENTICATED - Server authenticated Client " << InetSocketAddress::ConvertFrom (from).GetIpv4 () << " port " <<
                         InetSocketAddress::ConvertFrom (from).GetPort () << "");
-          m_authAddresses.push_back (InetSocketAddress::ConvertFrom (from).GetIpv4 ()); //add to the list of authenticated sockets
+          AddAuthAddress (InetSocketAddress::ConvertFrom (from).GetIpv4 ()); //add to the list of authenticated sockets
         }
       else if (header.IsHandshake () and !m_isServer and socket != nullptr)
         {
           NS_LOG_LOGIC ("CONNECTION AUTHENTICATED - Client authenticated Server " << InetSocketAddress::ConvertFrom (from).GetIpv4 () << " port " <<
                         InetSocketAddress::ConvertFrom (from).GetPort () << "");
-          m_authAddresses.push_back (InetSocketAddress::ConvertFrom (from).GetIpv4 ()); //add to the list of authenticated sockets
+          AddAuthAddress (InetSocketAddress::ConvertFrom (from).GetIpv4 ()); //add to the list of authenticated sockets
         }
       else if (header.IsORTT () and m_isServer)
         {
-          auto result = std::find (m_authAddresses.begin (), m_authAddresses.end (), InetSocketAddress::ConvertFrom (from).GetIpv4 ());
+          bool authenticated = IsAuthAddress (InetSocketAddress::ConvertFrom (from).GetIpv4 ());
           // check if a 0-RTT is allowed with this endpoint - or if the attribute m_0RTTHandshakeStart has been forced to be true
-          if (result == m_authAddresses.end () && m_0RTTHandshakeStart)
+          if (!authenticated && m_0RTTHandshakeStart)
             {
-              m_authAddresses.push_back (InetSocketAddress::ConvertFrom (from).GetIpv4 ()); //add to the list of authenticated sockets
+              AddAuthAddress (InetSocketAddress::ConvertFrom (from).GetIpv4 ()); //add to the list of authenticated sockets
             }
-          else if (result == m_authAddresses.end () && !m_0RTTHandshakeStart)
+          else if (!authenticated && !m_0RTTHandshakeStart)
             {
               NS_LOG_WARN ( this << " CONNECTION ABORTED: 0RTT Packet from unauthenticated address " << InetSocketAddress::ConvertFrom (from).GetIpv4 () << " port " <<
                             InetSocketAddress::ConvertFrom (from).GetPort ());
@@ -548,20 +631,20 @@ QuicL4Protocol::ForwardUp (Ptr<Socket> sock)
                         InetSocketAddress::ConvertFrom (from).GetPort () << "");
           NS_LOG_LOGIC ( this << " Cloning listening socket " << m_quicUdpBindingList.front ()->m_quicSocket);
           socket = CloneSocket (m_quicUdpBindingList.front ()->m_quicSocket);
-          socket->SetConnectionId (connectionId);
+          UpdateConnectionId (socket, connectionId);
           socket->Connect (from);
           socket->SetupCallback ();
 
         }
       else if (header.IsShort ())
         {
-          auto result = std::find (m_authAddresses.begin (), m_authAddresses.end (), InetSocketAddress::ConvertFrom (from).GetIpv4 ());
+          bool authenticated = IsAuthAddress (InetSocketAddress::ConvertFrom (from).GetIpv4 ());
 
-          if (result == m_authAddresses.end () && m_0RTTHandshakeStart)
+          if (!authenticated && m_0RTTHandshakeStart)
             {
-              m_authAddresses.push_back (InetSocketAddress::ConvertFrom (from).GetIpv4 ()); //add to the list of authenticated sockets
+              AddAuthAddress (InetSocketAddress::ConvertFrom (from).GetIpv4 ()); //add to the list of authenticated sockets
             }
-          else if (result == m_authAddresses.end () && !m_0RTTHandshakeStart)
+          else if (!authenticated && !m_0RTTHandshakeStart)
             {
               NS_LOG_WARN ( this << " CONNECTION ABORTED: Short Packet from unauthenticated address " << InetSocketAddress::ConvertFrom (from).GetIpv4 () << " port " <<
                             InetSocketAddress::ConvertFrom (from).GetPort ());
@@ -569,17 +652,95 @@ QuicL4Protocol::ForwardUp (Ptr<Socket> sock)
             }
         }
 
+      if (m_batchedReceive)
+        {
+          QuicRxBatchItem item;
+          item.m_socket = socket;
+          item.m_packet = packet;
+          item.m_header = header;
+          item.m_from = from;
+          m_rxBatch.push_back (item);
+          continue;
+        }
+
       // Handle callback for the correct socket
-      if (!m_socketHandlers[socket].IsNull ())
+      auto handler = m_socketHandlers.find (socket);
+      if (handler != m_socketHandlers.end () and !handler->second.IsNull ())
         {
           NS_LOG_LOGIC (this << " waking up handler of socket " << socket);
-          m_socketHandlers[socket] (packet, header, from);
+          handler->second (packet, header, from);
         }
       else
         {
           NS_FATAL_ERROR ( this << " no handler for socket " << socket);
         }
     }
+
+  if (!m_rxBatch.empty ())
+    {
+      DeliverReceiveBatch ();
+    }
+}
+
+void
+QuicL4Protocol::DeliverReceiveBatch ()
+{
+  NS_LOG_FUNCTION (this << m_rxBatch.size ());
+
+  // the handlers may send packets: deliver from a local batch, and give its
+  // storage back afterwards
+  std::vector<QuicRxBatchItem> batch;
+  batch.swap (m_rxBatch);
+
+  // the sockets are served in order of first appearance, so that runs do
+  // not depend on where the sockets are allocated
+  m_rxBatchGroups.clear ();
+  for (QuicRxBatchItem &item : batch)
+    {
+      item.m_group = m_rxBatchGroups.insert (std::make_pair (item.m_socket, m_rxBatchGroups.size ())).first->second;
+    }
+  std::stable_sort (batch.begin (), batch.end (),
+                    [] (const QuicRxBatchItem &a, const QuicRxBatchItem &b)
+                    {
+                      return a.m_group < b.m_group;
+                    });
+
+  auto first = batch.begin ();
+  while (first != batch.end ())
+    {
+      Ptr<QuicSocketBase> socket = first->m_socket;
+      auto last = first;
+      while (last != batch.end () and last->m_socket == socket)
+        {
+          ++last;
+        }
+
+      // an earlier group may have closed the socket
+      auto found = m_socketHandlers.find (socket);
+      if (found == m_socketHandlers.end () or found->second.IsNull ())
+        {
+          NS_LOG_WARN (this << " no handler for socket " << socket << ", dropping " << (last - first) << " packets");
+          first = last;
+          continue;
+        }
+      Callback<void, Ptr<Packet>, const QuicHeader&, Address& > handler = found->second;
+
+      NS_LOG_LOGIC (this << " waking up handler of socket " << socket << " for " << (last - first) << " packets");
+      socket->BeginReceiveBatch ();
+      for (auto it = first; it != last; ++it)
+        {
+          handler (it->m_packet, it->m_header, it->m_from);
+        }
+      socket->EndReceiveBatch ();
+      first = last;
+    }
+
+  batch.clear ();
+  m_rxBatchGroups.clear ();
+  if (m_rxBatch.empty ())
+    {
+      m_rxBatch.swap (batch);
+    }
 }
 
 void
@@ -588,7 +749,7 @@ QuicL4Protocol::SetRecvCallback (Callback<void, Ptr<Packet>, const QuicHeader&,
 
   NS_LOG_FUNCTION (this);
 
-  m_socketHandlers.insert ( std::pair< Ptr<Socket>, Callback<void, Ptr<Packet>, const QuicHeader&, Address& > > (sock,handler));
+  m_socketHandlers.insert (std::make_pair (sock, handler));
   QuicUdpBindingList::iterator it;
   for (it = m_quicUdpBindingList.begin (); it != m_quicUdpBindingList.end (); ++it)
     {
@@ -641,6 +802,9 @@ QuicL4Protocol::DoDispose (void)
 {
   NS_LOG_FUNCTION (this);
   m_quicUdpBindingList.clear ();
+  m_connectionIndex.clear ();
+  m_pathIndex.clear ();
+  m_socketHandlers.clear ();
 
   m_node = 0;
 //  m_downTarget.Nullify ();
@@ -660,10 +824,85 @@ QuicL4Protocol::CloneSocket (Ptr<QuicSocketBase> oldsock)
   udpBinding->m_quicSocket = newsock;
   udpBinding->m_pathId = 0;
   m_quicUdpBindingList.insert (m_quicUdpBindingList.end (), udpBinding);
+  IndexBinding (udpBinding);
 
   return newsock;
 }
 
+void
+QuicL4Protocol::IndexBinding (Ptr<QuicUdpBinding> binding)
+{
+  NS_LOG_FUNCTION (this);
+
+  Ptr<QuicSocketBase> socket = binding->m_quicSocket;
+  m_connectionIndex.insert (std::make_pair (socket->GetConnectionId (), socket));
+
+  std::vector<Ptr<QuicUdpBinding> > &paths = m_pathIndex[socket];
+  if (paths.size () <= binding->m_pathId)
+    {
+      paths.resize (binding->m_pathId + 1);
+    }
+  if (paths[binding->m_pathId] == nullptr)
+    {
+      paths[binding->m_pathId] = binding;
+    }
+}
+
+void
+QuicL4Protocol::ReindexSocket (Ptr<QuicSocketBase> socket)
+{
+  NS_LOG_FUNCTION (this << socket);
+
+  auto conn = m_connectionIndex.find (socket->GetConnectionId ());
+  if (conn != m_connectionIndex.end () and conn->second == socket)
+    {
+      m_connectionIndex.erase (conn);
+    }
+  m_pathIndex.erase (socket);
+
+  bool bound = false;
+  for (auto it = m_quicUdpBindingList.begin (); it != m_quicUdpBindingList.end (); ++it)
+    {
+      if ((*it)->m_quicSocket == socket)
+        {
+          IndexBinding (*it);
+          bound = true;
+        }
+    }
+
+  if (!bound)
+    {
+      m_socketHandlers.erase (socket);
+    }
+}
+
+void
+QuicL4Protocol::RebuildIndexes ()
+{
+  NS_LOG_FUNCTION (this);
+
+  m_connectionIndex.clear ();
+  m_pathIndex.clear ();
+  for (auto it = m_quicUdpBindingList.begin (); it != m_quicUdpBindingList.end (); ++it)
+    {
+      IndexBinding (*it);
+    }
+}
+
+void
+QuicL4Protocol::UpdateConnectionId (Ptr<QuicSocketBase> socket, uint64_t connectionId)
+{
+  NS_LOG_FUNCTION (this << socket << connectionId);
+
+  auto conn = m_connectionIndex.find (socket->GetConnectionId ());
+  if (conn != m_connectionIndex.end () and conn->second == socket)
+    {
+      m_connectionIndex.erase (conn);
+    }
+  socket->SetConnectionId (connectionId);
+  m_connectionIndex.insert (std::make_pair (connectionId, socket));
+}
+
 
 
 Ptr<Socket>
@@ -698,22 +937,12 @@ QuicL4Protocol::CreateSocket (TypeId congestionTypeId)
   // sockets associated to this L4 protocol
   Ptr<UniformRandomVariable> rand = CreateObject<UniformRandomVariable> ();
 
-  bool found = false;
   uint64_t connectionId;
-  while (not found)
+  do
     {
       connectionId = uint64_t (rand->GetValue (0, pow (2, 64) - 1));
-      found = true;
-      for (auto it = m_quicUdpBindingList.begin (); it != m_quicUdpBindingList.end (); ++it)
-        {
-          found = false;
-          if (connectionId == (*it)->m_quicSocket->GetConnectionId ())
-            {
-              break;
-            }
-          found = true;
-        }
     }
+  while (m_connectionIndex.find (connectionId) != m_connectionIndex.end ());
   socket->SetConnectionId (connectionId);
   Ptr<QuicUdpBinding> udpBinding = Create<QuicUdpBinding> ();
   udpBinding->m_budpSocket = nullptr;
@@ -721,6 +950,7 @@ QuicL4Protocol::CreateSocket (TypeId congestionTypeId)
   udpBinding->m_quicSocket = socket;
   udpBinding->m_pathId = 0;
   m_quicUdpBindingList.insert (m_quicUdpBindingList.end (), udpBinding);
+  IndexBinding (udpBinding);
 
   return socket;
 }
@@ -819,15 +1049,11 @@ QuicL4Protocol::SendPacket (Ptr<QuicSocketBase> socket, Ptr<Packet> pkt, const Q
   packetSent->AddHeader (outgoing);
   packetSent->AddAtEnd (pkt);
 
-  QuicUdpBindingList::const_iterator it;
-  for (it = m_quicUdpBindingList.begin (); it != m_quicUdpBindingList.end (); ++it)
+  auto bindings = m_pathIndex.find (socket);
+  if (bindings != m_pathIndex.end () and pathId < bindings->second.size ()
+      and bindings->second[pathId] != nullptr)
     {
-      Ptr<QuicUdpBinding> item = *it;
-      if (item->m_quicSocket == socket && item->m_pathId == pathId)
-        {
-          UdpSend (item->m_budpSocket, packetSent, 0);
-          break;
-        }
+      UdpSend (bindings->second[pathId]->m_budpSocket, packetSent, 0);
     }
 }
 
@@ -852,6 +1078,7 @@ QuicL4Protocol::RemoveSocket (Ptr<QuicSocketBase> socket)
               closedListener = true;
             }
           m_quicUdpBindingList.erase (iter);
+          ReindexSocket (socket);
 
           break;
         }
@@ -1016,6 +1243,7 @@ QuicL4Protocol::AddPath(uint8_t pathId, Ptr<QuicSocketBase> socket, Address loca
       udpBinding->m_quicSocket = socket;
       udpBinding->m_pathId = pathId;
       m_quicUdpBindingList.insert(m_quicUdpBindingList.end (),udpBinding);
+      IndexBinding (udpBinding);
       return res;
     }
   else if (Inet6SocketAddress::IsMatchingType (localAddress))
@@ -1030,6 +1258,7 @@ QuicL4Protocol::AddPath(uint8_t pathId, Ptr<QuicSocketBase> socket, Address loca
       udpBinding->m_quicSocket = socket;
       udpBinding->m_pathId = pathId;
       m_quicUdpBindingList.insert(m_quicUdpBindingList.end (),udpBinding);
+      IndexBinding (udpBinding);
       return res;
     }
   return -1;
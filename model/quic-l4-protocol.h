@@ -28,7 +28,10 @@
 
 #include <stdint.h>
 #include <map>
+#include <unordered_map>
+#include <list>
 #include "ns3/node.h"
+#include "ns3/nstime.h"
 #include "ns3/ipv4-address.h"
 #include "ns3/ipv6-address.h"
 #include "ns3/sequence-number.h"
@@ -239,11 +242,30 @@ public:
   void BindToNetDevice (Ptr<QuicSocketBase> socket, Ptr<NetDevice> netdevice);
 
   /**
-   * \brief Get the authenticated addresses vector
+   * \brief Get the authenticated addresses
    *
-   * \return The authenticated addresses vector for this L4 Protocol
+   * \return The authenticated addresses for this L4 Protocol, most recently used first
    */
-  const std::vector<Address >& GetAuthAddresses () const;
+  std::vector<Address> GetAuthAddresses () const;
+
+  /**
+   * \brief Add an address to the authenticated addresses
+   *
+   * An address that is already authenticated is only marked as recently used.
+   * If the MaxAuthAddresses limit is exceeded, the least recently used address
+   * is removed
+   *
+   * \param address the address
+   */
+  void AddAuthAddress (Ipv4Address address);
+
+  /**
+   * \brief Check if an address is authenticated, and mark it as recently used
+   *
+   * \param address the address
+   * \return true if the address is authenticated and has not expired
+   */
+  bool IsAuthAddress (Ipv4Address address);
 
   /**
    * \brief This method is called by the underlying UDP socket upon receiving a packet
@@ -437,13 +459,95 @@ private:
    */
   Ptr<QuicSocketBase> CloneSocket (Ptr<QuicSocketBase> oldsock);
 
+  /**
+   * \brief Hash of a smart pointer, used by the socket indexes
+   */
+  struct PtrHash
+  {
+    template <typename T>
+    std::size_t operator() (const Ptr<T> &p) const
+    {
+      return std::hash<T *> () (PeekPointer (p));
+    }
+  };
+
+  /**
+   * \brief Add a QuicUdp binding to the connection and path indexes
+   *
+   * If a binding for the same socket and path id, or a socket with the same
+   * connection ID, is already indexed, it is kept, as the first binding in
+   * m_quicUdpBindingList is the one used
+   *
+   * \param binding the binding
+   */
+  void IndexBinding (Ptr<QuicUdpBinding> binding);
+
+  /**
+   * \brief Rebuild the indexes of a socket from its bindings left in m_quicUdpBindingList
+   *
+   * \param socket the socket
+   */
+  void ReindexSocket (Ptr<QuicSocketBase> socket);
+
+  /**
+   * \brief Rebuild the indexes of all the sockets from m_quicUdpBindingList
+   */
+  void RebuildIndexes ();
+
+  /**
+   * \brief Set the connection ID of a socket and move it in the connection index
+   *
+   * \param socket the socket
+   * \param connectionId the new connection ID
+   */
+  void UpdateConnectionId (Ptr<QuicSocketBase> socket, uint64_t connectionId);
+
+  /**
+   * \brief Deliver the datagrams collected by ForwardUp in batched receive mode
+   *
+   * The datagrams are grouped by socket, keeping their order within each
+   * socket, and every group is delivered between BeginReceiveBatch and
+   * EndReceiveBatch calls on its socket. The groups are delivered in the
+   * order in which their sockets first appear in the batch; a group whose
+   * socket has no handler anymore (e.g., it was closed by an earlier group)
+   * is dropped
+   */
+  void DeliverReceiveBatch ();
+
+  /**
+   * \brief Remove the authenticated addresses unused for longer than m_authAddressTimeout
+   */
+  void ExpireAuthAddresses ();
+
+  /**
+   * \brief A received datagram waiting to be delivered in batched receive mode
+   */
+  struct QuicRxBatchItem
+  {
+    Ptr<QuicSocketBase> m_socket;  //!< The destination socket
+    Ptr<Packet> m_packet;          //!< The packet, without its QUIC header
+    QuicHeader m_header;           //!< The QUIC header
+    Address m_from;                //!< The address of the sender
+    uint32_t m_group;              //!< Rank of the socket by first appearance in the batch
+  };
+
+  typedef std::list<std::pair<Ipv4Address, Time> > AuthAddressList;  //!< Authenticated addresses and their last use, most recent first
+
   Ptr<Node> m_node;           //!< The node this stack is associated with
   TypeId m_rttTypeId;         //!< The type of RttEstimator objects
   TypeId m_congestionTypeId;  //!< The socket type of QUIC objects
   bool m_0RTTHandshakeStart;  //!< A flag indicating if the L4 Protocol allows the 0-RTT Hansdhake start
-  std::map <Ptr<Socket>, Callback<void, Ptr<Packet>, const QuicHeader&, Address& > > m_socketHandlers;  //!< Callback handlers for sockets
-
-  std::vector<Address > m_authAddresses;    //!< Authenticated addresses for this L4 Protocol
+  std::unordered_map <Ptr<Socket>, Callback<void, Ptr<Packet>, const QuicHeader&, Address& >, PtrHash> m_socketHandlers;  //!< Callback handlers for sockets
+  std::unordered_map <uint64_t, Ptr<QuicSocketBase> > m_connectionIndex;  //!< Sockets indexed by connection ID
+  std::unordered_map <Ptr<QuicSocketBase>, std::vector<Ptr<QuicUdpBinding> >, PtrHash> m_pathIndex;  //!< Bindings of each socket, indexed by path id
+
+  AuthAddressList m_authAddressList;        //!< Authenticated addresses for this L4 Protocol, in LRU order
+  std::unordered_map<Ipv4Address, AuthAddressList::iterator, Ipv4AddressHash> m_authAddresses;  //!< Index of m_authAddressList
+  Time m_authAddressTimeout;                //!< Time after which an unused authenticated address expires (0 to never expire)
+  uint32_t m_maxAuthAddresses;              //!< Max number of authenticated addresses (0 for no limit)
+  bool m_batchedReceive;                    //!< Deliver the datagrams queued on a UDP socket to each QUIC socket as a batch
+  std::vector<QuicRxBatchItem> m_rxBatch;   //!< Datagrams collected by ForwardUp in batched receive mode
+  std::unordered_map<Ptr<QuicSocketBase>, uint32_t, PtrHash> m_rxBatchGroups;  //!< Group of each socket in the batch being delivered
   QuicUdpBindingList m_quicUdpBindingList;  //!< List of QuicUdp bindings
   bool m_isServer;                          //!< A flag indicating if the L4 Protocol is server
 
@@ -75,7 +75,8 @@ QuicL5Protocol::GetTypeId (void)
 QuicL5Protocol::QuicL5Protocol ()
   : m_socket (0),
   m_node (0),
-  m_connectionId ()
+  m_connectionId (),
+  m_maxData (0)
 {
   NS_LOG_FUNCTION_NOARGS ();
   NS_LOG_LOGIC ("Made a QuicL5Protocol " << this);
@@ -237,7 +238,15 @@ int
 QuicL5Protocol::DispatchRecv (Ptr<Packet> data, Address &address)
 {
   NS_LOG_FUNCTION (this);
-  auto disgregated = DisgregateRecv (data);
+  // the frames could trigger another reception: work on the reused storage
+  // from a local vector
+  std::vector< std::pair<Ptr<Packet>, QuicSubheader> > disgregated;
+  disgregated.swap (m_recvFrames);
+  if (!DisgregateRecv (data, disgregated))
+    {
+      m_recvFrames.swap (disgregated);
+      return 0;
+    }
 
   if (m_socket->CheckIfPacketOverflowMaxDataLimit (disgregated))
     {
@@ -253,7 +262,7 @@ QuicL5Protocol::DispatchRecv (Ptr<Packet> data, Address &address)
   uint64_t currStreamNum = m_streams.size () - 1;
   for (auto &elem : disgregated)
     {
-      QuicSubheader sub = elem.second;
+      const QuicSubheader &sub = elem.second;
 
       // check if this is an ack frame
       if (!sub.IsAck ())
@@ -267,11 +276,14 @@ QuicL5Protocol::DispatchRecv (Ptr<Packet> data, Address &address)
         }
     }
 
-  CreateStream (QuicStream::RECEIVER, currStreamNum);
+  if (currStreamNum >= m_streams.size ())
+    {
+      CreateStream (QuicStream::RECEIVER, currStreamNum);
+    }
 
   for (auto it = disgregated.begin (); it != disgregated.end (); ++it)
     {
-      QuicSubheader sub = (*it).second;
+      QuicSubheader &sub = (*it).second;
 
       if (sub.IsRstStream () or sub.IsMaxStreamData ()
           or sub.IsStreamBlocked () or sub.IsStopSending ()
@@ -287,7 +299,12 @@ QuicL5Protocol::DispatchRecv (Ptr<Packet> data, Address &address)
               NS_LOG_INFO (
                 "Receiving frame on stream " << stream->GetStreamId () <<
                   " trigger stream");
-              stream->Recv ((*it).first, sub, address);
+              Ptr<Packet> frame = (*it).first;
+              if (frame == nullptr)
+                {
+                  frame = Create<Packet> ();
+                }
+              stream->Recv (frame, sub, address);
             }
         }
       else
@@ -299,6 +316,12 @@ QuicL5Protocol::DispatchRecv (Ptr<Packet> data, Address &address)
         }
     }
 
+  disgregated.clear ();
+  if (m_recvFrames.empty ())
+    {
+      m_recvFrames.swap (disgregated);
+    }
+
   // trigger ACK TX if the received packet was not ACK-only
   return !onlyAckFrames;
 }
@@ -321,6 +344,14 @@ QuicL5Protocol::Recv (Ptr<Packet> frame, Address &address)
   return frame->GetSize ();
 }
 
+int
+QuicL5Protocol::Recv (const std::vector<Ptr<Packet> > &frames, Address &address)
+{
+  NS_LOG_FUNCTION (this << frames.size ());
+
+  return m_socket->AppendingRx (frames, address);
+}
+
 std::vector<Ptr<Packet> >
 QuicL5Protocol::DisgregateSend (Ptr<Packet> data)
 {
@@ -357,54 +388,70 @@ QuicL5Protocol::DisgregateSend (Ptr<Packet> data)
   return disgregated;
 }
 
-std::vector< std::pair<Ptr<Packet>, QuicSubheader> >
-QuicL5Protocol::DisgregateRecv (Ptr<Packet> data)
+bool
+QuicL5Protocol::DisgregateRecv (Ptr<Packet> data, std::vector< std::pair<Ptr<Packet>, QuicSubheader> > &frames)
 {
   NS_LOG_FUNCTION (this);
 
   uint32_t dataSizeByte = data->GetSize ();
-  std::vector< std::pair<Ptr<Packet>, QuicSubheader> > disgregated;
+  frames.clear ();
   NS_LOG_INFO ("DisgregateRecv for a packet with size " << dataSizeByte);
   //data->Print(std::cout);
 
   // the packet could contain multiple frames
   // each of them starts with a subheader
   // cycle through the data packet and extract the frames
-  for (uint32_t start = 0; start < dataSizeByte; )
+  while (data->GetSize () > 0)
     {
-      QuicSubheader sub;
+      frames.push_back (std::make_pair (Ptr<Packet> (), QuicSubheader ()));
+      QuicSubheader &sub = frames.back ().second;
       data->RemoveHeader (sub);
+      uint32_t length = sub.GetLength ();
       NS_LOG_INFO ("subheader " << sub << " dataSizeByte " << dataSizeByte
-                                << " remaining " << data->GetSize () << " frame size " << sub.GetLength ());
-      Ptr<Packet> remainingfragment = data->CreateFragment (0, sub.GetLength ());
-      NS_LOG_INFO ("fragment size " << remainingfragment->GetSize ());
-
-      // remove the first portion of the packet
-      data->RemoveAtStart (sub.GetLength ());
-      start += sub.GetSerializedSize () + sub.GetLength ();
-      disgregated.push_back (std::make_pair (remainingfragment, sub));
-    }
+                                << " remaining " << data->GetSize () << " frame size " << length);
 
+      if (sub.IsStream () and !(sub.GetFrameType () & 0x02))
+        {
+          // stream frame without length field: its payload is the rest of the packet
+          frames.back ().first = data;
+          break;
+        }
+      if (length == 0)
+        {
+          continue;
+        }
+      if (length > data->GetSize ())
+        {
+          NS_LOG_WARN ("Frame length " << length << " exceeds the " << data->GetSize ()
+                                       << " remaining bytes, packet dropped");
+          frames.clear ();
+          return false;
+        }
+      if (length == data->GetSize ())
+        {
+          // last frame: its payload is the rest of the packet
+          frames.back ().first = data;
+          break;
+        }
 
-  return disgregated;
+      // the fragment shares the buffer of the packet, then the payload is
+      // skipped in the packet
+      frames.back ().first = data->CreateFragment (0, length);
+      data->RemoveAtStart (length);
+    }
+  return true;
 }
 
 Ptr<QuicStreamBase>
 QuicL5Protocol::SearchStream (uint64_t streamId)
 {
   NS_LOG_FUNCTION (this);
-  std::vector<Ptr<QuicStreamBase> >::iterator it = m_streams.begin ();
-  Ptr<QuicStreamBase> stream;
-  while (it != m_streams.end ())
+  // the streams are created in order, so the ID of a stream is its index
+  if (streamId < m_streams.size ())
     {
-      if ((*it)->GetStreamId () == streamId)
-        {
-          stream = *it;
-          break;
-        }
-      ++it;
+      return m_streams[streamId];
     }
-  return stream;
+  return nullptr;
 }
 
 void
@@ -467,13 +514,15 @@ uint64_t
 QuicL5Protocol::GetMaxData ()
 {
   NS_LOG_FUNCTION (this);
+  return m_maxData;
+}
 
-  uint64_t maxData = 0;
-  for (auto stream : m_streams)
-    {
-      maxData += stream->SendMaxStreamData ();
-    }
-  return maxData;
+void
+QuicL5Protocol::UpdateMaxData (uint32_t oldMaxStreamData, uint32_t newMaxStreamData)
+{
+  NS_LOG_FUNCTION (this << oldMaxStreamData << newMaxStreamData);
+  m_maxData += newMaxStreamData;
+  m_maxData -= oldMaxStreamData;
 }
 
 } // namespace ns3
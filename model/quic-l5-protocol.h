@@ -145,6 +145,17 @@ public:
    */
   int Recv (Ptr<Packet> frame, Address &address);
 
+  /**
+   * \brief Method called by a stream implementation to return the in-order frames (without header) received at once
+   *
+   * The application is notified once for the whole batch
+   *
+   * \param frames the frames, in stream order
+   * \param address the address of the sender
+   * \return the size of the frames
+   */
+  int Recv (const std::vector<Ptr<Packet> > &frames, Address &address);
+
   /**
    * \brief Create a vector with fragments of packets to be sent in different streams
    *
@@ -154,12 +165,22 @@ public:
   std::vector<Ptr<Packet> > DisgregateSend (Ptr<Packet> data);
 
   /**
-   * \brief Create a vector of frames, corresponding to frames of different streams aggregated in a single QUIC packet
+   * \brief Split a received QUIC packet into its frames, corresponding to frames of different streams
+   *
+   * The packet is consumed in place and no payload is copied: the payload of
+   * the last frame is the packet itself, the payloads of the other frames are
+   * fragments sharing its buffer, and frames without payload (e.g., ACK
+   * frames) carry a null packet
+   *
+   * Only a stream frame without length field, or a frame whose length covers
+   * exactly the rest of the packet, can end the packet: a frame longer than the
+   * remaining bytes makes the whole packet malformed
    *
    * \param data a smart pointer to the received packet
-   * \return a vector of pairs with frames as smart pointers to packets and subheaders
+   * \param frames the vector of pairs with frames and subheaders to fill (cleared first)
+   * \return false if the packet is malformed and must be dropped (frames is then empty)
    */
-  std::vector< std::pair<Ptr<Packet>, QuicSubheader> > DisgregateRecv (Ptr<Packet> data);
+  bool DisgregateRecv (Ptr<Packet> data, std::vector< std::pair<Ptr<Packet>, QuicSubheader> > &frames);
 
   /**
    * \brief get the stream associated to the ID
@@ -227,12 +248,22 @@ public:
    * \returns the new max data value
    */
   uint64_t GetMaxData ();
+
+  /**
+   * \brief Update MAX_DATA after the MAX_STREAM_DATA of a stream changed
+   *
+   * \param oldMaxStreamData the previous MAX_STREAM_DATA of the stream
+   * \param newMaxStreamData the new MAX_STREAM_DATA of the stream
+   */
+  void UpdateMaxData (uint32_t oldMaxStreamData, uint32_t newMaxStreamData);
 bool vnReceived;
 private:
   Ptr<QuicSocketBase> m_socket;                 //!< The Quic socket this stack is associated with
   Ptr<Node> m_node;                             //!< The node this stack is associated with
   uint64_t m_connectionId;                      //!< The connection id this stack is associated with
-  std::vector<Ptr<QuicStreamBase> > m_streams;  //!< The streams this stack is associated with
+  std::vector<Ptr<QuicStreamBase> > m_streams;  //!< The streams this stack is associated with, indexed by stream ID
+  uint64_t m_maxData;                           //!< Sum of MAX_STREAM_DATA of all the streams
+  std::vector< std::pair<Ptr<Packet>, QuicSubheader> > m_recvFrames;  //!< Frames of the last received packet, kept to reuse their storage
 };
 
 } // namespace ns3
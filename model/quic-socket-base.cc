@@ -502,6 +502,7 @@ QuicSocketBase::QuicSocketBase (void)
       QUIC_VERSION_NS3_IMPL),
     m_keyPhase (QuicHeader::PHASE_ZERO),
     m_lastReceived (Seconds (0.0)),
+    m_lastActivity (Seconds (0.0)),
     m_initial_max_stream_data (
       0),
     m_max_data (0),
@@ -525,11 +526,14 @@ QuicSocketBase::QuicSocketBase (void)
     m_lastRtt (Seconds (0.0)),
     m_queue_ack (false),
     m_numPacketsReceivedSinceLastAckSent (0),
-    m_pacingTimer (Timer::REMOVE_ON_DESTROY),
     m_enableMultipath(false),
     m_pathManager(0),
     m_scheduler (0),
-    m_subflows (0)
+    m_subflows (0),
+    m_activeSubflowsValid (false),
+    m_activeSubflowsVersion (1),
+    m_rxBatch (false),
+    m_rxBatchSend (false)
 {
   NS_LOG_FUNCTION (this);
 
@@ -539,8 +543,6 @@ QuicSocketBase::QuicSocketBase (void)
   m_receivedPacketNumbers = std::vector<SequenceNumber32> ();
 
   m_quicCongestionControlLegacy = false;
-  m_pacingTimer.SetFunction (&QuicSocketBase::NotifyPacingPerformed, this);
-
   // /**
   //  * [IETF DRAFT 10 - Quic Transport: sec 5.7.1]
   //  *
@@ -578,6 +580,7 @@ QuicSocketBase::QuicSocketBase (const QuicSocketBase& sock)   // Copy constructo
     m_vers (sock.m_vers),
     m_keyPhase (QuicHeader::PHASE_ZERO),
     m_lastReceived (sock.m_lastReceived),
+    m_lastActivity (sock.m_lastActivity),
     m_initial_max_stream_data (sock.m_initial_max_stream_data),
     m_max_data (sock.m_max_data),
     m_initial_max_stream_id_bidi (sock.m_initial_max_stream_id_bidi),
@@ -597,13 +600,15 @@ QuicSocketBase::QuicSocketBase (const QuicSocketBase& sock)   // Copy constructo
     m_numPacketsReceivedSinceLastAckSent (sock.m_numPacketsReceivedSinceLastAckSent),
     m_lastMaxData(0),
     m_maxDataInterval(10),
-    m_pacingTimer (Timer::REMOVE_ON_DESTROY),
     m_txTrace (sock.m_txTrace),
     m_rxTrace (sock.m_rxTrace),
     m_enableMultipath(sock.m_enableMultipath),
     m_pathManager(sock.m_pathManager),
     m_scheduler (sock.m_scheduler),
-    m_subflows (sock.m_subflows)
+    m_activeSubflowsValid (false),
+    m_activeSubflowsVersion (sock.m_activeSubflowsVersion + 1),
+    m_rxBatch (false),
+    m_rxBatchSend (false)
 {
   NS_LOG_FUNCTION (this);
 
@@ -622,7 +627,13 @@ QuicSocketBase::QuicSocketBase (const QuicSocketBase& sock)   // Copy constructo
   // m_txBuffer->SetQuicSocketState (m_tcb);
 
   // m_tcb->m_pacingRate = m_tcb->m_maxPacingRate;
-  m_pacingTimer.SetFunction (&QuicSocketBase::NotifyPacingPerformed, this);
+  // the subflows are copied, so that each socket owns the pacing timers it cancels
+  for (Ptr<MpQuicSubFlow> sflow : sock.m_subflows)
+    {
+      Ptr<MpQuicSubFlow> copy = CopyObject (sflow);
+      copy->m_pacingTimer.SetFunction (&QuicSocketBase::NotifyPacingPerformed, this);
+      m_subflows.push_back (copy);
+    }
 
   m_pathManager->SetSocket(this);
 }
@@ -647,9 +658,12 @@ QuicSocketBase::~QuicSocketBase (void)
       NS_ASSERT (m_endPoint6 == nullptr);
     }
   m_quicl4 = 0;
+  for (Ptr<MpQuicSubFlow> sflow : m_subflows)
+    {
+      sflow->m_pacingTimer.Cancel ();
+    }
   m_subflows.clear();
   //CancelAllTimers ();
-  m_pacingTimer.Cancel ();
 }
 
 /* Inherit from Socket class: Bind socket to an end-point in QuicL4Protocol */
@@ -867,11 +881,7 @@ QuicSocketBase::Connect (const Address & address)
     }
 
   // check if the address is in a list of known and authenticated addresses
-  auto result = std::find (
-    m_quicl4->GetAuthAddresses ().begin (), m_quicl4->GetAuthAddresses ().end (),
-    InetSocketAddress::ConvertFrom (address).GetIpv4 ());
-
-  if (result != m_quicl4->GetAuthAddresses ().end ()
+  if (m_quicl4->IsAuthAddress (InetSocketAddress::ConvertFrom (address).GetIpv4 ())
       || m_quicl4->Is0RTTHandshakeAllowed ())
     {
       NS_LOG_INFO (
@@ -1005,12 +1015,12 @@ QuicSocketBase::SendPendingData (bool withAck)
     if (m_subflows[0]->m_tcb->m_pacing)
     {
       NS_LOG_DEBUG ("Pacing is enabled");
-      if (m_pacingTimer.IsRunning ())
+      if (!m_subflows[0]->PacingAllowsSend ())
         {
-          NS_LOG_INFO ("Skipping Packet due to pacing - for " << m_pacingTimer.GetDelayLeft ());
+          NS_LOG_INFO ("Skipping Packet due to pacing - for " << m_subflows[0]->m_pacingTimer.GetDelayLeft ());
           break;
         }
-      NS_LOG_DEBUG ("Pacing Timer is not running");
+      NS_LOG_DEBUG ("Pacing allows sending on path 0");
     }
 
     uint32_t win = AvailableWindow (0); //just use first subflow to deal with stream 0
@@ -1045,95 +1055,95 @@ QuicSocketBase::SendPendingData (bool withAck)
   }
 
 
-  std::vector<double> sendP = m_scheduler->GetNextPathIdToUse();
+  m_scheduler->GetNextPathIdToUse(m_sendWeights);
 
-  for (uint8_t sendingPathId = 0; sendingPathId < sendP.size(); sendingPathId++)
-  {
-    uint32_t availableWindow = AvailableWindow (sendingPathId);
-    uint32_t sendSize = m_txBuffer->AppSize () * sendP[sendingPathId];
-    uint32_t sendNumber = sendSize/GetSegSize();
-    if (sendSize > availableWindow)
+  // at most the packets that fit in the windows of the paths when the call
+  // starts, so that the loop ends even if a packet carries no stream data
+  uint32_t packetBudget = 0;
+  for (uint8_t pathId = 0; pathId < m_sendWeights.size (); pathId++)
     {
-      sendNumber = availableWindow/GetSegSize();
-    } 
-
-    while (sendNumber > 0 and availableWindow > 0 and m_txBuffer->AppSize () > 0)
-      {
-        // check draining period
-        if (m_drainingPeriodEvent.IsRunning ())
-          {
-            NS_LOG_INFO ("Draining period: no packets can be sent");
-            return false;
-          }
-
-        // check pacing timer
-        if (m_subflows[sendingPathId]->m_tcb->m_pacing)
-          {
-            NS_LOG_DEBUG ("Pacing is enabled");
-            if (m_pacingTimer.IsRunning ())
-              {
-                NS_LOG_INFO ("Skipping Packet due to pacing - for " << m_pacingTimer.GetDelayLeft ());
-                break;
-              }
-            NS_LOG_DEBUG ("Pacing Timer is not running");
-          }
+      packetBudget += AvailableWindow (pathId) / GetSegSize () + 1;
+    }
 
-        // check the state of the socket!
-        if (m_socketState == CONNECTING_CLT || m_socketState == CONNECTING_SVR)
-          {
-            NS_LOG_INFO ("CONNECTING_CLT and CONNECTING_SVR state; no data to transmit");
-            break;
-          }
+  while (m_txBuffer->AppSize () > 0 and packetBudget > 0)
+    {
+      // check draining period
+      if (m_drainingPeriodEvent.IsRunning ())
+        {
+          NS_LOG_INFO ("Draining period: no packets can be sent");
+          return false;
+        }
 
-        uint32_t availableData = m_txBuffer->AppSize ();
+      // check the state of the socket!
+      if (m_socketState == CONNECTING_CLT || m_socketState == CONNECTING_SVR)
+        {
+          NS_LOG_INFO ("CONNECTING_CLT and CONNECTING_SVR state; no data to transmit");
+          break;
+        }
 
-        if (availableData < availableWindow and !m_closeOnEmpty)
-          {
-            NS_LOG_INFO ("Ask the app for more data before trying to send");
-            NotifySend (GetTxAvailable ());
-          }
+      uint8_t sendingPathId = GetNextSendingPath ();
+      if (sendingPathId >= m_sendWeights.size ())
+        {
+          NS_LOG_INFO ("No path can send");
+          break;
+        }
 
-        if (availableWindow < GetSegSize () and availableData > availableWindow and !m_closeOnEmpty)
-          {
-            NS_LOG_INFO ("Preventing Silly Window Syndrome. Wait to Send.");
-            break;
-          }
+      uint32_t availableWindow = AvailableWindow (sendingPathId);
+      uint32_t availableData = m_txBuffer->AppSize ();
 
-        SequenceNumber32 next = ++m_subflows[sendingPathId]->m_tcb->m_nextTxSequence;
+      if (availableData < availableWindow and !m_closeOnEmpty)
+        {
+          NS_LOG_INFO ("Ask the app for more data before trying to send");
+          NotifySend (GetTxAvailable ());
+        }
 
-        uint32_t s = std::min (availableWindow, GetSegSize ());
+      SequenceNumber32 next = ++m_subflows[sendingPathId]->m_tcb->m_nextTxSequence;
 
-        uint32_t win = AvailableWindow (sendingPathId); // mark: to be AvailableWindow (m_lastUsedsFlowIdx)
-        uint32_t connWin = ConnectionWindow (sendingPathId);
-        uint32_t bytesInFlight = BytesInFlight (sendingPathId);
+      uint32_t s = std::min (availableWindow, GetSegSize ());
 
-        NS_LOG_DEBUG (
-          "BEFORE Available Window " << win
-                                    << " Connection RWnd " << connWin
-                                    << " BytesInFlight " << bytesInFlight
-                                    << " BufferedSize " << m_txBuffer->AppSize ()
-                                    << " MaxPacketSize " << GetSegSize ());
+      uint32_t win = AvailableWindow (sendingPathId);
+      uint32_t connWin = ConnectionWindow (sendingPathId);
+      uint32_t bytesInFlight = BytesInFlight (sendingPathId);
 
-        NS_LOG_INFO ("on path " << sendingPathId << " SN " << next);
-        // uint32_t sz =
-        SendDataPacket (next, s, withAck, sendingPathId);
+      NS_LOG_DEBUG (
+        "BEFORE Available Window " << win
+                                  << " Connection RWnd " << connWin
+                                  << " BytesInFlight " << bytesInFlight
+                                  << " BufferedSize " << m_txBuffer->AppSize ()
+                                  << " MaxPacketSize " << GetSegSize ());
 
-        win = AvailableWindow (sendingPathId);
-        connWin = ConnectionWindow (sendingPathId);
-        bytesInFlight = BytesInFlight (sendingPathId);
-        NS_LOG_DEBUG (
-          "AFTER Available Window " << win
-                                    << " Connection RWnd " << connWin
-                                    << " BytesInFlight " << bytesInFlight
-                                    << " BufferedSize " << m_txBuffer->AppSize ()
-                                    << " MaxPacketSize " << GetSegSize ());
+      NS_LOG_INFO ("on path " << (uint16_t) sendingPathId << " SN " << next);
+      int32_t sent = SendDataPacket (next, s, withAck, sendingPathId);
+      if (sent < 0)
+        {
+          NS_LOG_INFO ("No packet sent on path " << (uint16_t) sendingPathId);
+          break;
+        }
 
-        ++nPacketsSent;
+      win = AvailableWindow (sendingPathId);
+      connWin = ConnectionWindow (sendingPathId);
+      bytesInFlight = BytesInFlight (sendingPathId);
+      NS_LOG_DEBUG (
+        "AFTER Available Window " << win
+                                  << " Connection RWnd " << connWin
+                                  << " BytesInFlight " << bytesInFlight
+                                  << " BufferedSize " << m_txBuffer->AppSize ()
+                                  << " MaxPacketSize " << GetSegSize ());
+
+      ++nPacketsSent;
+      --packetBudget;
+      if (sent == 0)
+        {
+          NS_LOG_INFO ("No stream data fits the window of path " << (uint16_t) sendingPathId << ". Wait to Send.");
+          break;
+        }
 
-        availableWindow = AvailableWindow(sendingPathId);
-        sendNumber--;
-      }
-  }
+      // the path of the next packet depends on the frame now at the head
+      if (m_scheduler->IsPerPacket () and m_txBuffer->AppSize () > 0)
+        {
+          m_scheduler->GetNextPathIdToUse (m_sendWeights);
+        }
+    }
 
   if (nPacketsSent > 0)
     {
@@ -1147,6 +1157,76 @@ QuicSocketBase::SendPendingData (bool withAck)
   return nPacketsSent;
 }
 
+uint8_t
+QuicSocketBase::GetNextSendingPath ()
+{
+  NS_LOG_FUNCTION (this);
+
+  uint8_t numPaths = m_sendWeights.size ();
+  m_eligibleWeights.assign (numPaths, 0.0);
+  for (uint8_t pathId = 0; pathId < numPaths; pathId++)
+    {
+      if (m_sendWeights[pathId] <= 0.0)
+        {
+          continue;
+        }
+
+      // check pacing timer
+      if (m_subflows[pathId]->m_tcb->m_pacing and !m_subflows[pathId]->PacingAllowsSend ())
+        {
+          NS_LOG_INFO ("Skipping path " << (uint16_t) pathId << " due to pacing - for " << m_subflows[pathId]->m_pacingTimer.GetDelayLeft ());
+          continue;
+        }
+
+      uint32_t availableWindow = AvailableWindow (pathId);
+      if (availableWindow == 0)
+        {
+          continue;
+        }
+      if (availableWindow < GetSegSize () and m_txBuffer->AppSize () > availableWindow and !m_closeOnEmpty)
+        {
+          NS_LOG_INFO ("Preventing Silly Window Syndrome on path " << (uint16_t) pathId << ". Wait to Send.");
+          continue;
+        }
+
+      m_eligibleWeights[pathId] = m_sendWeights[pathId];
+    }
+
+  return PickWeightedPath (m_eligibleWeights, m_sendCredits);
+}
+
+uint8_t
+QuicSocketBase::PickWeightedPath (const std::vector<double> &weights, std::vector<double> &credits)
+{
+  uint8_t numPaths = weights.size ();
+  if (credits.size () != numPaths)
+    {
+      credits.assign (numPaths, 0.0);
+    }
+
+  uint8_t bestPathId = numPaths;
+  double totalWeight = 0.0;
+  for (uint8_t pathId = 0; pathId < numPaths; pathId++)
+    {
+      if (weights[pathId] <= 0.0)
+        {
+          continue;
+        }
+      credits[pathId] += weights[pathId];
+      totalWeight += weights[pathId];
+      if (bestPathId == numPaths or credits[pathId] > credits[bestPathId])
+        {
+          bestPathId = pathId;
+        }
+    }
+
+  if (bestPathId < numPaths)
+    {
+      credits[bestPathId] -= totalWeight;
+    }
+  return bestPathId;
+}
+
 void
 QuicSocketBase::SetSegSize (uint32_t size)
 {
@@ -1168,7 +1248,7 @@ QuicSocketBase::MaybeQueueAck (uint8_t pathId)
   NS_LOG_INFO ("m_numPacketsReceivedSinceLastAckSent " << m_subflows[pathId]->m_numPacketsReceivedSinceLastAckSent << " m_queue_ack " << m_subflows[pathId]->m_queue_ack);
 
   // handle the list of m_receivedPacketNumbers
-  if (m_subflows[pathId]->m_receivedPacketNumbers.empty ())
+  if (m_subflows[pathId]->m_receivedPacketNumbers.IsEmpty ())
     {
       NS_LOG_INFO ("Nothing to ACK");
       m_subflows[pathId]->m_queue_ack = false;
@@ -1242,7 +1322,7 @@ QuicSocketBase::SendAck (uint8_t pathId)
 
   
   Ptr<Packet> p = Create<Packet> ();
-  if (!m_subflows[pathId]->m_receivedPacketNumbers.empty())
+  if (!m_subflows[pathId]->m_receivedPacketNumbers.IsEmpty ())
   {
     p->AddAtEnd (OnSendingAckFrame (pathId));
     SequenceNumber32 packetNumber = ++m_subflows[pathId]->m_tcb->m_nextTxSequence;
@@ -1263,7 +1343,7 @@ QuicSocketBase::SendAck (uint8_t pathId)
 }
 
 
-uint32_t
+int32_t
 QuicSocketBase::SendDataPacket (SequenceNumber32 packetNumber, uint32_t maxSize, bool withAck, uint8_t pathId)
 {
   NS_LOG_FUNCTION (this << packetNumber << maxSize << withAck);
@@ -1272,9 +1352,7 @@ QuicSocketBase::SendDataPacket (SequenceNumber32 packetNumber, uint32_t maxSize,
 
   if (!m_drainingPeriodEvent.IsRunning ())
     {
-      m_idleTimeoutEvent.Cancel ();
-      NS_LOG_LOGIC (this << " SendDataPacket Schedule Close at time " << Simulator::Now ().GetSeconds () << " to expire at time " << (Simulator::Now () + m_idleTimeout.Get ()).GetSeconds ());
-      m_idleTimeoutEvent = Simulator::Schedule (m_idleTimeout, &QuicSocketBase::Close, this);
+      ResetIdleTimeout ();
     }
   else
     {
@@ -1292,7 +1370,6 @@ QuicSocketBase::SendDataPacket (SequenceNumber32 packetNumber, uint32_t maxSize,
   else
     {
       NS_LOG_LOGIC (this << " SendDataPacket - sending packet " << packetNumber.GetValue () << " of size " << maxSize << " at time " << Simulator::Now ().GetSeconds ());
-      m_idleTimeoutEvent = Simulator::Schedule (m_idleTimeout, &QuicSocketBase::Close, this);
       p = m_txBuffer->NextSequence (maxSize, packetNumber, pathId, m_scheduler->GetCurrentRound());
     }
 
@@ -1308,24 +1385,14 @@ QuicSocketBase::SendDataPacket (SequenceNumber32 packetNumber, uint32_t maxSize,
   // perform pacing
   if (m_subflows[pathId]->m_tcb->m_pacing)
     {
-      NS_LOG_DEBUG ("Pacing is enabled");
-      if (m_pacingTimer.IsExpired ())
-        {
-          NS_LOG_DEBUG ("Current Pacing Rate " << m_subflows[pathId]->m_tcb->m_pacingRate);
-          NS_LOG_DEBUG ("Pacing Timer is in expired state, activate it. Expires in " <<
-                        m_subflows[pathId]->m_tcb->m_pacingRate.Get ().CalculateBytesTxTime (sz));
-          m_pacingTimer.Schedule (m_subflows[pathId]->m_tcb->m_pacingRate.Get ().CalculateBytesTxTime (sz));
-        }
-      else
-        {
-          NS_LOG_INFO ("Pacing Timer is already in running state");
-        }
+      NS_LOG_DEBUG ("Pacing is enabled, current pacing rate " << m_subflows[pathId]->m_tcb->m_pacingRate);
+      m_subflows[pathId]->ConsumePacingTokens (sz);
     }
 
   bool isAckOnly = ((sz == 0) & (withAck));
 
 
-  if (withAck && !m_subflows[pathId]->m_receivedPacketNumbers.empty ())
+  if (withAck && !m_subflows[pathId]->m_receivedPacketNumbers.IsEmpty ())
     {
       p->AddAtEnd (OnSendingAckFrame (pathId));
 
@@ -1541,7 +1608,7 @@ QuicSocketBase::ReTxTimeout (uint8_t pathId)
       NS_LOG_INFO ("TLP triggered");
       uint32_t s = std::min (ConnectionWindow (pathId), GetSegSize ());
       // cancel pacing to send packet immediately
-      m_pacingTimer.Cancel ();
+      m_subflows[pathId]->m_pacingTimer.Cancel ();
 
       SendDataPacket (next, s, m_connected,pathId);
       m_subflows[pathId]->m_tcb->m_tlpCount++;
@@ -1559,7 +1626,7 @@ QuicSocketBase::ReTxTimeout (uint8_t pathId)
       uint32_t s = std::min (AvailableWindow (pathId), GetSegSize ());
 
       // cancel pacing to send packet immediately
-      m_pacingTimer.Cancel ();
+      m_subflows[pathId]->m_pacingTimer.Cancel ();
 
       SendDataPacket (next, s, m_connected,pathId);
       next = ++m_subflows[pathId]->m_tcb->m_nextTxSequence;
@@ -1567,7 +1634,7 @@ QuicSocketBase::ReTxTimeout (uint8_t pathId)
       s = std::min (AvailableWindow (pathId), GetSegSize ());
 
       // cancel pacing, again
-      m_pacingTimer.Cancel ();
+      m_subflows[pathId]->m_pacingTimer.Cancel ();
 
       SendDataPacket (next, s, m_connected,pathId);
 
@@ -1646,6 +1713,22 @@ QuicSocketBase::Recv (uint32_t maxSize, uint32_t flags)
   return outPacket;
 }
 
+uint32_t
+QuicSocketBase::RecvSegments (uint32_t maxSize, std::vector<Ptr<const Packet> > &segments) const
+{
+  NS_LOG_FUNCTION (this << maxSize);
+
+  return m_rxBuffer->GetSegments (maxSize, segments);
+}
+
+uint32_t
+QuicSocketBase::ConsumeRecv (uint32_t size)
+{
+  NS_LOG_FUNCTION (this << size);
+
+  return m_rxBuffer->Consume (size);
+}
+
 /* Inherit from Socket class: Recv and return the remote's address */
 Ptr<Packet>
 QuicSocketBase::RecvFrom (uint32_t maxSize, uint32_t flags, Address &fromAddress)
@@ -1683,6 +1766,38 @@ QuicSocketBase::ScheduleCloseAndSendConnectionClosePacket ()
 }
 
 
+void
+QuicSocketBase::ResetIdleTimeout ()
+{
+  m_lastActivity = Simulator::Now ();
+
+  // the pending event is only moved if the idle timeout was shortened
+  if (!m_idleTimeoutEvent.IsRunning ()
+      or Simulator::GetDelayLeft (m_idleTimeoutEvent) > m_idleTimeout.Get ())
+    {
+      m_idleTimeoutEvent.Cancel ();
+      NS_LOG_LOGIC (this << " Schedule idle timeout check at time " << (Simulator::Now () + m_idleTimeout.Get ()).GetSeconds ());
+      m_idleTimeoutEvent = Simulator::Schedule (m_idleTimeout, &QuicSocketBase::IdleTimeoutExpired, this);
+    }
+}
+
+void
+QuicSocketBase::IdleTimeoutExpired ()
+{
+  NS_LOG_FUNCTION (this);
+
+  Time deadline = m_lastActivity + m_idleTimeout.Get ();
+  if (deadline > Simulator::Now ())
+    {
+      NS_LOG_LOGIC (this << " Activity since the idle timeout was set, check again at time " << deadline.GetSeconds ());
+      m_idleTimeoutEvent = Simulator::Schedule (deadline - Simulator::Now (), &QuicSocketBase::IdleTimeoutExpired, this);
+      return;
+    }
+
+  NS_LOG_LOGIC (this << " Idle timeout expired, close at time " << Simulator::Now ().GetSeconds ());
+  Close ();
+}
+
 int
 QuicSocketBase::Close (void)
 {
@@ -1892,6 +2007,36 @@ QuicSocketBase::AppendingRx (Ptr<Packet> frame, Address &address)
   return frame->GetSize ();
 }
 
+int
+QuicSocketBase::AppendingRx (const std::vector<Ptr<Packet> > &frames, Address &address)
+{
+  NS_LOG_FUNCTION (this << frames.size ());
+
+  int added = 0;
+  for (const Ptr<Packet> &frame : frames)
+    {
+      if (frame->GetSize () == 0)
+        {
+          continue;
+        }
+      if (!m_rxBuffer->Add (frame))
+        {
+          // Insert failed: No data or RX buffer full
+          NS_LOG_INFO ("Dropping packet due to full RX buffer");
+          break;
+        }
+      added += frame->GetSize ();
+    }
+
+  if (added > 0)
+    {
+      NS_LOG_INFO ("Notify Data Recv");
+      NotifyDataRecv ();   // trigger the application method
+    }
+
+  return added;
+}
+
 void
 QuicSocketBase::SetQuicL4 (Ptr<QuicL4Protocol> quic)
 {
@@ -2193,45 +2338,22 @@ QuicSocketBase::OnSendingAckFrame (uint8_t pathId)
 {
   NS_LOG_FUNCTION (this);
 
-  NS_ABORT_MSG_IF (m_subflows[pathId]->m_receivedPacketNumbers.empty (),
+  NS_ABORT_MSG_IF (m_subflows[pathId]->m_receivedPacketNumbers.IsEmpty (),
                    " Sending Ack Frame without packets to acknowledge");
 
 
   NS_LOG_INFO ("Attach an ACK frame to the packet");
 
-  std::sort (m_subflows[pathId]->m_receivedPacketNumbers.begin (), m_subflows[pathId]->m_receivedPacketNumbers.end (),
-             std::greater<SequenceNumber32> ());
+  MpQuicReceivedPacketSet &received = m_subflows[pathId]->m_receivedPacketNumbers;
+  SequenceNumber32 largestAcknowledged = received.GetLargest ();
 
-  SequenceNumber32 largestAcknowledged = *(m_subflows[pathId]->m_receivedPacketNumbers.begin ());
-
-  uint32_t ackBlockCount = 0;
-  std::vector<uint32_t> additionalAckBlocks;
-  std::vector<uint32_t> gaps;
-
-  std::vector<SequenceNumber32>::const_iterator curr_rec_it =
-    m_subflows[pathId]->m_receivedPacketNumbers.begin ();
-  std::vector<SequenceNumber32>::const_iterator next_rec_it =
-    m_subflows[pathId]->m_receivedPacketNumbers.begin () + 1;
-
-  for (; next_rec_it != m_subflows[pathId]->m_receivedPacketNumbers.end ();
-       ++curr_rec_it, ++next_rec_it)
-    {
-
-      if (((*curr_rec_it) - (*next_rec_it) - 1 > 0)
-          and ((*curr_rec_it) != (*next_rec_it)))
-        {
-          //std::clog << "curr " << (*curr_rec_it) << " next " << (*next_rec_it) << " ";
-          additionalAckBlocks.push_back ((*next_rec_it).GetValue ());
-          gaps.push_back ((*curr_rec_it).GetValue () - 1);
-          ackBlockCount++;
-        }
-      // Limit the number of gaps that are sent in an ACK (older packets have already been retransmitted)
-      if (ackBlockCount >= m_maxTrackedGaps)
-        {
-          break;
-        }
-    }
+  // Limit the number of gaps that are sent in an ACK (older packets have already been retransmitted)
+  QuicAckBlockList additionalAckBlocks;
+  QuicAckBlockList gaps;
+  received.GetAckBlocks (m_maxTrackedGaps, gaps, additionalAckBlocks);
 
+  // The last block acknowledges all the older packets, stop tracking them separately
+  received.Trim (m_maxTrackedGaps);
 
   Time delay = Simulator::Now () - m_lastReceived;
   uint64_t ack_delay = delay.GetMicroSeconds ();
@@ -2275,8 +2397,8 @@ QuicSocketBase::OnReceivedAckFrame (QuicSubheader &sub)
 
   uint32_t previousWindow = m_txBuffer->BytesInFlight (pathId);
 
-  std::vector<uint32_t> additionalAckBlocks = sub.GetAdditionalAckBlocks ();
-  std::vector<uint32_t> gaps = sub.GetGaps ();
+  const QuicAckBlockList &additionalAckBlocks = sub.GetAdditionalAckBlocks ();
+  const QuicAckBlockList &gaps = sub.GetGaps ();
   uint32_t largestAcknowledged = sub.GetLargestAcknowledged ();
   m_subflows[pathId]->m_tcb->m_lastAckedSeq = largestAcknowledged;
   uint32_t ackBlockCount = sub.GetAckBlockCount ();
@@ -2455,6 +2577,18 @@ QuicSocketBase::OnReceivedAckFrame (QuicSubheader &sub)
 
 
 
+  if (m_rxBatch)
+    {
+      // send and compute timers once for the whole batch
+      m_rxBatchSend = true;
+      if (m_rxBatchRetx.size () <= pathId)
+        {
+          m_rxBatchRetx.resize (pathId + 1, false);
+        }
+      m_rxBatchRetx[pathId] = true;
+      return;
+    }
+
   // try to send more data
   SendPendingData (m_connected);
 
@@ -2662,10 +2796,7 @@ QuicSocketBase::ReceivedData (Ptr<Packet> p, const QuicHeader& quicHeader,
   NS_LOG_INFO ("Received packet of size " << p->GetSize ());
   if (!m_drainingPeriodEvent.IsRunning ())
     {
-      m_idleTimeoutEvent.Cancel ();   // reset the IDLE timeout
-      NS_LOG_LOGIC (
-        this << " ReceivedData Schedule Close at time " << Simulator::Now ().GetSeconds () << " to expire at time " << (Simulator::Now () + m_idleTimeout.Get ()).GetSeconds ());
-      m_idleTimeoutEvent = Simulator::Schedule (m_idleTimeout, &QuicSocketBase::Close, this);
+      ResetIdleTimeout ();   // reset the IDLE timeout
     }
   else   // If the socket is in Draining Period, discard the packets
     {
@@ -2688,7 +2819,7 @@ QuicSocketBase::ReceivedData (Ptr<Packet> p, const QuicHeader& quicHeader,
       m_couldContainTransportParameters = true;
 
       onlyAckFrames = m_quicl5->DispatchRecv (p, address);
-      m_subflows[pathId]->m_receivedPacketNumbers.push_back (quicHeader.GetPacketNumber ());
+      m_subflows[pathId]->m_receivedPacketNumbers.Add (quicHeader.GetPacketNumber ());
 
       m_connected = true;
       m_keyPhase == QuicHeader::PHASE_ONE ? m_keyPhase =
@@ -2722,7 +2853,7 @@ QuicSocketBase::ReceivedData (Ptr<Packet> p, const QuicHeader& quicHeader,
         }
 
       onlyAckFrames = m_quicl5->DispatchRecv (p, address);
-      m_subflows[pathId]->m_receivedPacketNumbers.push_back (quicHeader.GetPacketNumber ());
+      m_subflows[pathId]->m_receivedPacketNumbers.Add (quicHeader.GetPacketNumber ());
 
       if (IsVersionSupported (quicHeader.GetVersion ()))
         {
@@ -2744,7 +2875,7 @@ QuicSocketBase::ReceivedData (Ptr<Packet> p, const QuicHeader& quicHeader,
       NS_LOG_INFO ("Client receives HANDSHAKE");
 
       onlyAckFrames = m_quicl5->DispatchRecv (p, address);
-      m_subflows[pathId]->m_receivedPacketNumbers.push_back (quicHeader.GetPacketNumber ());
+      m_subflows[pathId]->m_receivedPacketNumbers.Add (quicHeader.GetPacketNumber ());
 
       SetState (OPEN);
       Simulator::ScheduleNow(&QuicSocketBase::ConnectionSucceeded, this);
@@ -2764,7 +2895,7 @@ QuicSocketBase::ReceivedData (Ptr<Packet> p, const QuicHeader& quicHeader,
       CreateNewSubflows();
 
       onlyAckFrames = m_quicl5->DispatchRecv (p, address);
-      m_subflows[pathId]->m_receivedPacketNumbers.push_back (quicHeader.GetPacketNumber ());
+      m_subflows[pathId]->m_receivedPacketNumbers.Add (quicHeader.GetPacketNumber ());
       SetState (OPEN);
       Simulator::ScheduleNow (&QuicSocketBase::ConnectionSucceeded, this);
       m_congestionControl->CongestionStateSet (m_subflows[pathId]->m_tcb,TcpSocketState::CA_OPEN);
@@ -2826,7 +2957,7 @@ QuicSocketBase::ReceivedData (Ptr<Packet> p, const QuicHeader& quicHeader,
       // in this case we cannot explicitely ACK it!
       // check if delayed ACK is used
       
-      m_subflows[pathId]->m_receivedPacketNumbers.push_back (quicHeader.GetPacketNumber ());
+      m_subflows[pathId]->m_receivedPacketNumbers.Add (quicHeader.GetPacketNumber ());
       onlyAckFrames = m_quicl5->DispatchRecv (p, address);
 
     }
@@ -2988,18 +3119,17 @@ QuicSocketBase::GetReceivedTransportParametersFlag () const
 
 bool
 QuicSocketBase::CheckIfPacketOverflowMaxDataLimit (
-  std::vector<std::pair<Ptr<Packet>, QuicSubheader> > disgregated)
+  const std::vector<std::pair<Ptr<Packet>, QuicSubheader> > &disgregated)
 {
   NS_LOG_FUNCTION (this);
   uint32_t validPacketSize = 0;
   for (auto frame_recv_it = disgregated.begin ();
-       frame_recv_it != disgregated.end () and !disgregated.empty ();
+       frame_recv_it != disgregated.end ();
        ++frame_recv_it)
     {
-      QuicSubheader sub = (*frame_recv_it).second;
-      // (*frame_recv_it)->PeekHeader (sub);
+      const QuicSubheader &sub = (*frame_recv_it).second;
 
-      if (sub.IsStream () and sub.GetStreamId () != 0)
+      if (sub.IsStream () and sub.GetStreamId () != 0 and (*frame_recv_it).first != nullptr)
         {
           validPacketSize += (*frame_recv_it).first->GetSize ();
         }
@@ -3190,6 +3320,26 @@ Time QuicSocketBase::GetDefaultLatency ()
   return m_txBuffer->GetDefaultLatency ();
 }
 
+Time QuicSocketBase::GetTxHeadDeadline ()
+{
+  return m_txBuffer->GetHeadDeadline ();
+}
+
+void QuicSocketBase::DeprioritizeLateFrames (Time deliveryTime)
+{
+  m_txBuffer->DeprioritizeLateFrames (deliveryTime);
+}
+
+void QuicSocketBase::SetStreamWeight (uint64_t streamId, uint32_t weight)
+{
+  m_txBuffer->SetStreamWeight (streamId, weight);
+}
+
+void QuicSocketBase::SetStreamPriorityClass (uint64_t streamId, uint8_t priorityClass)
+{
+  m_txBuffer->SetStreamPriorityClass (streamId, priorityClass);
+}
+
 void
 QuicSocketBase::NotifyPacingPerformed (void)
 {
@@ -3237,7 +3387,9 @@ void
 QuicSocketBase::SubflowInsert(Ptr<MpQuicSubFlow> sflow)
 {
   NS_LOG_FUNCTION (this);
+  sflow->m_pacingTimer.SetFunction (&QuicSocketBase::NotifyPacingPerformed, this);
   m_subflows.insert(m_subflows.end(), sflow);
+  InvalidateActiveSubflows();
 }
 
 void
@@ -3307,7 +3459,7 @@ QuicSocketBase::OnReceivedPathChallengeFrame (QuicSubheader &sub)
 {
   NS_LOG_FUNCTION (this);
   m_subflows[m_currentPathId]->m_peerAddr = m_currentFromAddress;
-  m_subflows[m_currentPathId]->m_subflowState = MpQuicSubFlow::Active;
+  m_pathManager->SetSubflowState(m_subflows[m_currentPathId], MpQuicSubFlow::Active);
   m_quicl4->ReDoUdpConnect(m_currentPathId, m_currentFromAddress);
   m_txBuffer->AddSentList(m_currentPathId);
   SendPathResponse(m_currentPathId);
@@ -3335,23 +3487,41 @@ void
 QuicSocketBase::OnReceivedPathResponseFrame (QuicSubheader &sub)
 {
   NS_LOG_FUNCTION (this);
-  m_subflows[m_currentPathId]->m_subflowState = MpQuicSubFlow::Active;
+  m_pathManager->SetSubflowState(m_subflows[m_currentPathId], MpQuicSubFlow::Active);
   m_txBuffer->AddSentList(m_currentPathId);
 }
 
 
-std::vector<Ptr<MpQuicSubFlow>>
+const std::vector<Ptr<MpQuicSubFlow>> &
 QuicSocketBase::GetActiveSubflows()
 {
   NS_LOG_FUNCTION(this);
-  std::vector<Ptr<MpQuicSubFlow>> sflows;
-  for (uint16_t i = 0; i < m_subflows.size(); i++)
+  if (!m_activeSubflowsValid)
   {
-    if (m_subflows[i]->m_subflowState == MpQuicSubFlow::Active){
-      sflows.insert(sflows.end(), m_subflows[i]);
+    m_activeSubflows.clear();
+    for (uint16_t i = 0; i < m_subflows.size(); i++)
+    {
+      if (m_subflows[i]->m_subflowState == MpQuicSubFlow::Active){
+        m_activeSubflows.insert(m_activeSubflows.end(), m_subflows[i]);
+      }
     }
+    m_activeSubflowsValid = true;
   }
-  return sflows;
+  return m_activeSubflows;
+}
+
+uint32_t
+QuicSocketBase::GetActiveSubflowsVersion() const
+{
+  return m_activeSubflowsVersion;
+}
+
+void
+QuicSocketBase::InvalidateActiveSubflows()
+{
+  NS_LOG_FUNCTION(this);
+  m_activeSubflowsValid = false;
+  m_activeSubflowsVersion++;
 }
 
 double
@@ -3398,6 +3568,37 @@ QuicSocketBase::GetOliaAlpha(uint8_t pathId)
 
 }
 
+void
+QuicSocketBase::BeginReceiveBatch ()
+{
+  NS_LOG_FUNCTION (this);
+  m_rxBatch = true;
+}
+
+void
+QuicSocketBase::EndReceiveBatch ()
+{
+  NS_LOG_FUNCTION (this);
+  m_rxBatch = false;
+
+  if (m_rxBatchSend)
+    {
+      m_rxBatchSend = false;
+      // try to send more data
+      SendPendingData (m_connected);
+    }
+
+  // Compute timers
+  for (uint8_t pathId = 0; pathId < m_rxBatchRetx.size (); pathId++)
+    {
+      if (m_rxBatchRetx[pathId])
+        {
+          m_rxBatchRetx[pathId] = false;
+          SetReTxTimeout (pathId);
+        }
+    }
+}
+
 uint32_t 
 QuicSocketBase::GetBytesInBuffer()
 {
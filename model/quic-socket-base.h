@@ -319,6 +319,15 @@ public:
    */
   int AppendingRx (Ptr<Packet> frame, Address &address);
 
+  /**
+   * \brief Add the stream frames received at once to the RX buffer and call NotifyDataRecv once
+   *
+   * \param frames the frames, in stream order
+   * \param address the RX address
+   * \return the size of the frames added, which stops at the first frame that does not fit
+   */
+  int AppendingRx (const std::vector<Ptr<Packet> > &frames, Address &address);
+
   /**
    * \brief Set the L4 Protocol
    *
@@ -428,7 +437,7 @@ public:
    * \param a vector of pairs with received frames and subheaders
    * \return a boolean, true if the limit was exceeded
    */
-  bool CheckIfPacketOverflowMaxDataLimit (std::vector<std::pair<Ptr<Packet>, QuicSubheader> > disgregated);
+  bool CheckIfPacketOverflowMaxDataLimit (const std::vector<std::pair<Ptr<Packet>, QuicSubheader> > &disgregated);
 
   /**
    * \brief Get the maximum of stream ID (i.e., number of streams - 1)
@@ -601,6 +610,24 @@ public:
   virtual int SendTo (Ptr<Packet> p, uint32_t flags, const Address &toAddress);
   virtual Ptr<Packet> Recv (uint32_t maxSize, uint32_t flags);
   virtual Ptr<Packet> RecvFrom (uint32_t maxSize, uint32_t flags, Address &fromAddress);
+  /**
+   * \brief Get up to maxSize bytes of received data as the list of the
+   * buffered packets, without merging them and without removing the data
+   *
+   * The data is removed from the socket with ConsumeRecv
+   *
+   * \param maxSize the maximum number of bytes to return
+   * \param segments the vector the segments are appended to
+   * \return the number of bytes in the returned segments
+   */
+  uint32_t RecvSegments (uint32_t maxSize, std::vector<Ptr<const Packet> > &segments) const;
+  /**
+   * \brief Remove size bytes of received data, e.g., after reading them with RecvSegments
+   *
+   * \param size the number of bytes to remove
+   * \return the number of bytes actually removed
+   */
+  uint32_t ConsumeRecv (uint32_t size);
   virtual int Bind (void);  // Bind a socket by setting up the UDP socket in QuicL4Protocol
   virtual int Bind (const Address &address);
   virtual int Bind6 (void);
@@ -652,6 +679,36 @@ public:
    */
   Time GetDefaultLatency ();
 
+  /**
+   * Get the deadline of the next frame to be sent
+   *
+   * \return The deadline, or Time::Max () if the scheduler has no deadlines
+   */
+  Time GetTxHeadDeadline ();
+
+  /**
+   * Move the frames that cannot meet their deadline behind the other ones
+   *
+   * \param deliveryTime The earliest time at which a frame sent now can be delivered
+   */
+  void DeprioritizeLateFrames (Time deliveryTime);
+
+  /**
+   * Set the weight of a stream for the weighted fair queueing scheduler
+   *
+   * \param streamId The stream ID
+   * \param weight The stream's weight
+   */
+  void SetStreamWeight (uint64_t streamId, uint32_t weight);
+
+  /**
+   * Set the strict priority class of a stream for the weighted fair queueing scheduler
+   *
+   * \param streamId The stream ID
+   * \param priorityClass The stream's class (the lowest class is served first)
+   */
+  void SetStreamPriorityClass (uint64_t streamId, uint8_t priorityClass);
+
   /**
    * \brief TracedCallback signature for QUIC packet transmission or reception events.
    *
@@ -680,9 +737,62 @@ public:
   void AddPath(Address address, Address from, uint8_t pathId);
 
   // For scheduler use
-  std::vector<Ptr<MpQuicSubFlow>> GetActiveSubflows();
+  /**
+   * \brief Get the subflows in the Active state
+   *
+   * The list is cached, and only rebuilt after InvalidateActiveSubflows.
+   *
+   * \return the active subflows
+   */
+  const std::vector<Ptr<MpQuicSubFlow>> & GetActiveSubflows();
+
+  /**
+   * \brief Get the version of the active subflow list
+   *
+   * The version changes every time the list is invalidated, so that users
+   * keeping a copy of it know when to refresh it.
+   *
+   * \return the version of the active subflow list
+   */
+  uint32_t GetActiveSubflowsVersion() const;
+
+  /**
+   * \brief Invalidate the cached active subflow list
+   *
+   * Called by the path manager when a subflow is added or changes state.
+   */
+  void InvalidateActiveSubflows();
   uint32_t GetBytesInBuffer();
 
+  /**
+   * \brief Start processing a batch of received packets
+   *
+   * Until EndReceiveBatch is called, the ACK frames do not trigger
+   * SendPendingData and SetReTxTimeout: these are run once for the whole batch
+   */
+  void BeginReceiveBatch ();
+
+  /**
+   * \brief End a batch of received packets
+   *
+   * Send the pending data and set the retransmission timers of the paths that
+   * received ACK frames during the batch
+   */
+  void EndReceiveBatch ();
+
+  /**
+   * \brief Pick a path by smooth weighted round robin
+   *
+   * Every path with a positive weight accumulates its weight as credit, the
+   * path with the largest credit is picked and pays back the sum of the
+   * weights. The credits are kept across calls, so the packets are
+   * interleaved in proportion to the weights.
+   *
+   * \param weights the weight of each path, 0 for the paths that cannot send
+   * \param credits the credit of each path, reset if its size does not match
+   * \return the id of the path, or the number of weights if no weight is positive
+   */
+  static uint8_t PickWeightedPath (const std::vector<double> &weights, std::vector<double> &credits);
 
 
 protected:
@@ -723,10 +833,10 @@ protected:
    * \param seq the sequence number
    * \param maxSize the maximum data block to be transmitted (in bytes)
    * \param withAck forces an ACK to be sent
-   * \returns the number of bytes sent
+   * \returns the number of bytes sent, or -1 during the draining period
    */
   // uint32_t SendDataPacket (SequenceNumber32 packetNumber, uint32_t maxSize, bool withAck);
-  uint32_t SendDataPacket (SequenceNumber32 packetNumber, uint32_t maxSize, bool withAck, uint8_t pathId);
+  int32_t SendDataPacket (SequenceNumber32 packetNumber, uint32_t maxSize, bool withAck, uint8_t pathId);
 
   /**
    * \brief Send a Connection Close frame
@@ -745,6 +855,16 @@ protected:
    */
   uint32_t SendPendingData (bool withAck = false);
 
+  /**
+   * \brief Pick the path on which the next data packet is sent
+   *
+   * The scheduler's weights of the paths that can send are turned into an
+   * interleaved sequence of paths by PickWeightedPath.
+   *
+   * \return the id of the path, or the number of weights if no path can send
+   */
+  uint8_t GetNextSendingPath ();
+
   /**
    * \brief Perform the real connection tasks: start the initial handshake for non-0-RTT
    *
@@ -776,6 +896,22 @@ protected:
   void ReceivedData (Ptr<Packet> p, const QuicHeader& quicHeader,
                      Address &address);
 
+  /**
+   * \brief Record activity on the connection for the idle timeout
+   *
+   * The idle timeout event is not moved on every packet: it stays pending,
+   * and IdleTimeoutExpired re-arms it if there was activity in the meantime
+   */
+  void ResetIdleTimeout ();
+
+  /**
+   * \brief Called when the idle timeout event fires
+   *
+   * Close the connection if it has been idle for m_idleTimeout, otherwise
+   * re-arm the event for the remaining time
+   */
+  void IdleTimeoutExpired ();
+
   /**
    * \brief Update the state of the internal state machine
    *
@@ -809,6 +945,8 @@ protected:
 
   /**
    * \brief Notify Pacing
+   *
+   * Called when the pacing timer of a subflow expires
    */
   void NotifyPacingPerformed (void);
   /**
@@ -843,6 +981,7 @@ protected:
   uint32_t m_vers;                          //!< Quic protocol version
   QuicHeader::KeyPhase_t m_keyPhase;        //!< Key phase
   Time m_lastReceived;                      //!< Time of last received packet
+  Time m_lastActivity;                      //!< Time of last sent or received packet, for the idle timeout
 
   // Transport Parameters values
   uint32_t m_initial_max_stream_data;    //!< The initial value for the maximum data that can be sent on any newly created stream
@@ -862,7 +1001,7 @@ protected:
   // Timers and Events
   EventId m_sendPendingDataEvent;             //!< Micro-delay event to send pending data
   EventId m_retxEvent;                        //!< Retransmission event
-  EventId m_idleTimeoutEvent;                 //!< Event triggered upon receiving or sending a packet, when it expires the connection closes
+  EventId m_idleTimeoutEvent;                 //!< Idle timeout event, when it expires after m_idleTimeout without activity the connection closes
   EventId m_drainingPeriodEvent;              //!< Event triggered upon idle timeout or immediate connection close, when it expires all closes
   TracedValue<Time> m_rto;                    //!< Retransmit timeout
   TracedValue<Time> m_drainingPeriodTimeout;  //!< Draining Period timeout
@@ -883,9 +1022,6 @@ protected:
 
   uint32_t m_initialPacketSize; //!< size of the first packet to be sent durin the handshake (at least 1200 bytes, per RFC)
 
-  // Pacing timer
-  Timer m_pacingTimer       {Timer::REMOVE_ON_DESTROY}; //!< Pacing Event
-
   /**
   * \brief Callback pointer for cWnd trace chaining
   */
@@ -935,6 +1071,15 @@ protected:
   Ptr<MpQuicPathManager> m_pathManager;
   Ptr<MpQuicScheduler> m_scheduler;
   std::vector <Ptr<MpQuicSubFlow>> m_subflows;
+  std::vector <Ptr<MpQuicSubFlow>> m_activeSubflows;   //!< Cached subflows in the Active state
+  bool m_activeSubflowsValid;                          //!< True if m_activeSubflows is up to date
+  uint32_t m_activeSubflowsVersion;                    //!< Incremented when m_activeSubflows is invalidated
+  std::vector<double> m_sendWeights;                   //!< Per-path weights filled by the scheduler
+  std::vector<double> m_sendCredits;                   //!< Per-path credits of the weighted packet distribution
+  std::vector<double> m_eligibleWeights;               //!< Per-path weights of the paths that can send the next packet
+  bool m_rxBatch;                                      //!< True while a batch of received packets is processed
+  bool m_rxBatchSend;                                  //!< True if SendPendingData runs at the end of the batch
+  std::vector<bool> m_rxBatchRetx;                     //!< Paths whose retransmission timer is set at the end of the batch
   uint8_t m_currentPathId;
   Address m_currentFromAddress;
   
@@ -136,30 +136,21 @@ QuicSocketRxBuffer::Extract (uint32_t maxSize)
 
   Ptr<Packet> outPkt = Create<Packet> ();
 
-  QuicSocketRxPacketList::iterator it = m_socketRecvList.begin ();
-
-  while (extractSize > 0 && !m_socketRecvList.empty () && it != m_socketRecvList.end ())
+  while (!m_socketRecvList.empty ())
     {
-      it = m_socketRecvList.begin ();
-      Ptr<Packet> currentPacket = *it;
+      Ptr<Packet> currentPacket = m_socketRecvList.front ();
 
-      if (currentPacket->GetSize () + outPkt->GetSize () <= extractSize)   // Merge
-        {
-
-          outPkt->AddAtEnd ((*it));
-          m_socketRecvList.erase (it);
-
-          m_recvSize -= (*it)->GetSize ();
-          extractSize -= (*it)->GetSize ();
-          NS_LOG_LOGIC ("Added packet of size " << (*it)->GetSize ());
-          continue;
-        }
-      else
+      if (currentPacket->GetSize () + outPkt->GetSize () > extractSize)
         {
           break;
         }
 
-      it++;
+      // Merge
+      outPkt->AddAtEnd (currentPacket);
+      m_socketRecvList.pop_front ();
+
+      m_recvSize -= currentPacket->GetSize ();
+      NS_LOG_LOGIC ("Added packet of size " << currentPacket->GetSize ());
     }
 
   if (outPkt->GetSize () == 0)
@@ -172,6 +163,61 @@ QuicSocketRxBuffer::Extract (uint32_t maxSize)
   return outPkt;
 }
 
+uint32_t
+QuicSocketRxBuffer::GetSegments (uint32_t maxSize, std::vector<Ptr<const Packet> > &segments) const
+{
+  NS_LOG_FUNCTION (this << maxSize);
+
+  uint32_t segmentsSize = 0;
+  for (QuicSocketRxPacketList::const_iterator it = m_socketRecvList.begin ();
+       it != m_socketRecvList.end () and segmentsSize < maxSize; ++it)
+    {
+      uint32_t size = (*it)->GetSize ();
+      if (segmentsSize + size > maxSize)
+        {
+          size = maxSize - segmentsSize;
+          segments.push_back ((*it)->CreateFragment (0, size));
+        }
+      else
+        {
+          segments.push_back (*it);
+        }
+      segmentsSize += size;
+    }
+
+  NS_LOG_INFO ("Returned " << segments.size () << " segments with " << segmentsSize << " bytes");
+  return segmentsSize;
+}
+
+uint32_t
+QuicSocketRxBuffer::Consume (uint32_t size)
+{
+  NS_LOG_FUNCTION (this << size);
+
+  uint32_t consumed = 0;
+  while (consumed < size and !m_socketRecvList.empty ())
+    {
+      Ptr<Packet> currentPacket = m_socketRecvList.front ();
+      uint32_t packetSize = currentPacket->GetSize ();
+
+      if (consumed + packetSize > size)
+        {
+          // the buffer owns its packets, so the head one is trimmed in place
+          currentPacket->RemoveAtStart (size - consumed);
+          m_recvSize -= size - consumed;
+          consumed = size;
+          break;
+        }
+
+      m_socketRecvList.pop_front ();
+      m_recvSize -= packetSize;
+      consumed += packetSize;
+    }
+
+  NS_LOG_INFO ("Consumed " << consumed << " bytes from QuicSocketRxBuffer. New buffer size=" << m_recvSize);
+  return consumed;
+}
+
 uint32_t
 QuicSocketRxBuffer::Available (void) const
 {
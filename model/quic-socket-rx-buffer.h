@@ -26,6 +26,8 @@
 #define QUICSOCKETRXBUFFER_H
 
 #include <map>
+#include <deque>
+#include <vector>
 #include "ns3/traced-value.h"
 #include "ns3/trace-source-accessor.h"
 #include "ns3/sequence-number.h"
@@ -149,9 +151,30 @@ public:
    */
   Ptr<Packet> Extract (uint32_t maxSize);
 
+  /**
+   * Get the data at the head of the buffer as the list of the buffered
+   * packets, without merging them and without removing them from the buffer
+   *
+   * If the last packet does not fit in maxSize, a fragment with its first
+   * bytes is returned. The segments must not be modified, and stay valid
+   * until the data is consumed with Consume
+   *
+   * \param maxSize the maximum number of bytes to return
+   * \param segments the vector the segments are appended to
+   * \return the number of bytes in the returned segments
+   */
+  uint32_t GetSegments (uint32_t maxSize, std::vector<Ptr<const Packet> > &segments) const;
+
+  /**
+   * Remove size bytes from the head of the buffer
+   *
+   * \param size the number of bytes to remove
+   * \return the number of bytes actually removed
+   */
+  uint32_t Consume (uint32_t size);
+
 private:
-  typedef std::vector<QuicSocketRxItem*> QuicStreamRxPacketList;  //!< Container for data stored in the buffer
-  typedef std::vector<Ptr<Packet> > QuicSocketRxPacketList;       //!< Container for data stored in the buffer
+  typedef std::deque<Ptr<Packet> > QuicSocketRxPacketList;       //!< Container for data stored in the buffer
 
   QuicSocketRxPacketList m_socketRecvList;  //!< List of received packets with additional info
   uint32_t m_recvSize;                      //!< Current buffer occupancy
@@ -33,25 +33,17 @@
 #include "ns3/packet.h"
 #include "ns3/log.h"
 #include "ns3/abort.h"
+#include "ns3/boolean.h"
 #include "quic-subheader.h"
 #include "quic-socket-base.h"
 #include "quic-socket-tx-scheduler.h"
 #include "quic-socket-tx-edf-scheduler.h"
+#include "quic-socket-tx-drr-scheduler.h"
 
 namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("QuicSocketTxBuffer");
 
-TypeId QuicSocketTxItem::GetTypeId (void)
-{
-  static TypeId tid = TypeId ("ns3::QuicSocketTxItem")
-    .SetParent<Object>()
-    .SetGroupName ("Internet")
-    .AddConstructor<QuicSocketTxItem>()
-  ;
-  return tid;
-}
-
 QuicSocketTxItem::QuicSocketTxItem () 
   : m_packet (0), 
     m_packetNumber (0), 
@@ -67,7 +59,13 @@ QuicSocketTxItem::QuicSocketTxItem ()
 }
 
 QuicSocketTxItem::QuicSocketTxItem (const QuicSocketTxItem &other)
-  : m_packet (other.m_packet),
+  : QuicSocketTxItem (other, other.m_packet->Copy ())
+{
+}
+
+QuicSocketTxItem::QuicSocketTxItem (const QuicSocketTxItem &other, Ptr<Packet> packet)
+  : SimpleRefCount<QuicSocketTxItem> (other),
+    m_packet (packet),
     m_packetNumber (other.m_packetNumber), 
     m_lost (other.m_lost), 
     m_retrans (other.m_retrans), 
@@ -78,7 +76,18 @@ QuicSocketTxItem::QuicSocketTxItem (const QuicSocketTxItem &other)
     m_lastSent (other.m_lastSent), 
     m_generated (other.m_generated)
 {
-  m_packet = other.m_packet->Copy ();
+}
+
+void *
+QuicSocketTxItem::operator new (std::size_t size)
+{
+  return QuicItemPool<QuicSocketTxItem>::Allocate (size);
+}
+
+void
+QuicSocketTxItem::operator delete (void *p, std::size_t size)
+{
+  QuicItemPool<QuicSocketTxItem>::Release (p, size);
 }
 
 void QuicSocketTxItem::Print (std::ostream &os) const
@@ -186,6 +195,131 @@ void QuicSocketTxItem::SplitItems (QuicSocketTxItem &t1, QuicSocketTxItem &t2,
                  "Wrong size " << t1.m_packet->GetSize ());
 }
 
+QuicSocketTxSentList::QuicSocketTxSentList ()
+  : m_first (0),
+    m_size (0)
+{
+}
+
+void
+QuicSocketTxSentList::Insert (Ptr<QuicSocketTxItem> item)
+{
+  if (m_slots.empty ())
+    {
+      m_first = item->m_packetNumber;
+    }
+
+  int32_t offset = item->m_packetNumber - m_first;
+  NS_ASSERT_MSG (offset >= (int32_t) m_slots.size (),
+                 "Packet " << item->m_packetNumber << " inserted out of order in the sent list");
+  // Untracked packet numbers in between are left as empty slots
+  m_slots.resize (offset);
+  m_slots.push_back (item);
+  while (m_links.size () < m_slots.size ())
+    {
+      m_links.push_back (m_first + (int32_t) m_links.size ());
+    }
+  ++m_size;
+}
+
+void
+QuicSocketTxSentList::Erase (uint32_t index)
+{
+  NS_ASSERT_MSG (index < m_slots.size () && m_slots[index] != nullptr,
+                 "No item in slot " << index);
+  m_slots[index] = nullptr;
+  --m_size;
+
+  while (!m_slots.empty () && m_slots.front () == nullptr)
+    {
+      m_slots.pop_front ();
+      m_links.pop_front ();
+      ++m_first;
+    }
+}
+
+Ptr<QuicSocketTxItem>
+QuicSocketTxSentList::At (uint32_t index) const
+{
+  return m_slots[index];
+}
+
+Ptr<QuicSocketTxItem>
+QuicSocketTxSentList::Find (SequenceNumber32 seq) const
+{
+  if (m_slots.empty ())
+    {
+      return nullptr;
+    }
+
+  int32_t offset = seq - m_first;
+  if (offset < 0 || offset >= (int32_t) m_slots.size ())
+    {
+      return nullptr;
+    }
+  return m_slots[offset];
+}
+
+uint32_t
+QuicSocketTxSentList::UpperBound (SequenceNumber32 seq) const
+{
+  if (m_slots.empty ())
+    {
+      return 0;
+    }
+
+  int32_t offset = seq - m_first;
+  if (offset < 0)
+    {
+      return 0;
+    }
+  return std::min ((uint32_t) offset + 1, (uint32_t) m_slots.size ());
+}
+
+uint32_t
+QuicSocketTxSentList::GetLinkEnd (uint32_t index) const
+{
+  int32_t offset = m_links[index] - m_first;
+  return offset < 0 ? 0 : offset;
+}
+
+uint32_t
+QuicSocketTxSentList::FindUnacked (uint32_t end)
+{
+  uint32_t found = end;
+  while (found > 0 && (m_slots[found - 1] == nullptr || m_slots[found - 1]->m_sacked))
+    {
+      found = GetLinkEnd (found - 1);
+    }
+
+  // Link the slots visited to the result, so that the run is skipped next time
+  while (end > found)
+    {
+      uint32_t next = GetLinkEnd (end - 1);
+      m_links[end - 1] = m_first + (int32_t) found;
+      end = next;
+    }
+  return found;
+}
+
+uint32_t
+QuicSocketTxSentList::GetSpan () const
+{
+  return m_slots.size ();
+}
+
+uint32_t
+QuicSocketTxSentList::GetSize () const
+{
+  return m_size;
+}
+
+bool
+QuicSocketTxSentList::IsEmpty () const
+{
+  return m_size == 0;
+}
+
 NS_OBJECT_ENSURE_REGISTERED (QuicSocketTxBuffer);
 
 TypeId QuicSocketTxBuffer::GetTypeId (void)
@@ -193,6 +327,11 @@ TypeId QuicSocketTxBuffer::GetTypeId (void)
   static TypeId tid =
     TypeId ("ns3::QuicSocketTxBuffer").SetParent<Object>().SetGroupName (
       "Internet").AddConstructor<QuicSocketTxBuffer>()
+    .AddAttribute ("ValidateBytesInFlight",
+                   "Cross-check the per-path bytes in flight counters against a full scan of the sent list",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&QuicSocketTxBuffer::m_validateBytesInFlight),
+                   MakeBooleanChecker ())
 //    .AddTraceSource ("UnackSequence",
 //                     "First unacknowledged sequence number (SND.UNA)",
 //                     MakeTraceSourceAccessor (&QuicSocketTxBuffer::m_sentSize),
@@ -203,11 +342,12 @@ TypeId QuicSocketTxBuffer::GetTypeId (void)
 
 QuicSocketTxBuffer::QuicSocketTxBuffer () :
   m_maxBuffer (32768), m_streamZeroSize (0), m_numFrameStream0InBuffer (
-    0)
+    0), m_validateBytesInFlight (false)
 {
   m_streamZeroList = QuicTxPacketList ();
-  m_subflowSentList.insert(m_subflowSentList.end(), QuicTxPacketList ());
+  m_subflowSentList.insert(m_subflowSentList.end(), QuicSocketTxSentList ());
   m_sentSizeList.insert(m_sentSizeList.end(), 0);
+  m_bytesInFlightList.insert(m_bytesInFlightList.end(), 0);
 }
 
 QuicSocketTxBuffer::~QuicSocketTxBuffer (void)
@@ -217,6 +357,7 @@ QuicSocketTxBuffer::~QuicSocketTxBuffer (void)
   m_streamZeroSize = 0;
   m_subflowSentList.clear();
   m_sentSizeList.clear();
+  m_bytesInFlightList.clear();
 }
 
 void QuicSocketTxBuffer::Print (std::ostream &os) const
@@ -226,9 +367,13 @@ void QuicSocketTxBuffer::Print (std::ostream &os) const
   std::stringstream ss;
   std::stringstream as;
   
-  for (it = m_subflowSentList[0].begin (); it != m_subflowSentList[0].end (); ++it)
+  for (uint32_t index = 0; index < m_subflowSentList[0].GetSpan (); ++index)
     {
-      (*it)->Print (ss);
+      Ptr<QuicSocketTxItem> item = m_subflowSentList[0].At (index);
+      if (item != nullptr)
+        {
+          item->Print (ss);
+        }
     }
 
   for (it = m_streamZeroList.begin (); it != m_streamZeroList.end (); ++it)
@@ -238,7 +383,7 @@ void QuicSocketTxBuffer::Print (std::ostream &os) const
 
   os << Simulator::Now ().GetSeconds () << "\nStream 0 list: \n" << as.str ()
      << "\n\nSent list: \n" << ss.str () << "\n\nCurrent Status: "
-     << "\nNumber of transmissions = " << m_subflowSentList[0].size ()
+     << "\nNumber of transmissions = " << m_subflowSentList[0].GetSize ()
      << "\nSent Size = " << m_sentSizeList[0]
      << "\nNumber of stream 0 packets waiting = "
      << m_streamZeroList.size () << "\nStream 0 waiting packet size = "
@@ -257,7 +402,7 @@ bool QuicSocketTxBuffer::Add (Ptr<Packet> p)
     {
       if (p->GetSize () > 0)
         {
-          Ptr<QuicSocketTxItem> item = CreateObject<QuicSocketTxItem> ();
+          Ptr<QuicSocketTxItem> item = Create<QuicSocketTxItem> ();
           item->m_packet = p;
           // check to which stream this packet belongs to
           uint32_t streamId = 0;
@@ -303,7 +448,7 @@ Ptr<Packet> QuicSocketTxBuffer::NextStream0Sequence (
 {
   NS_LOG_FUNCTION (this << seq);
 
-  Ptr<QuicSocketTxItem> outItem = CreateObject<QuicSocketTxItem> ();
+  Ptr<QuicSocketTxItem> outItem = Create<QuicSocketTxItem> ();
 
   QuicTxPacketList::iterator it = m_streamZeroList.begin ();
   if (it != m_streamZeroList.end ())
@@ -315,7 +460,7 @@ Ptr<Packet> QuicSocketTxBuffer::NextStream0Sequence (
       outItem->m_isStream0 = (*it)->m_isStream0;
       m_streamZeroList.erase (it);
       m_streamZeroSize -= currentPacket->GetSize ();
-      m_subflowSentList[0].insert (m_subflowSentList[0].end (), outItem);  //only use path 0 to deal with stream 0
+      m_subflowSentList[0].Insert (outItem);  //only use path 0 to deal with stream 0
       m_sentSizeList[0] += outItem->m_packet->GetSize ();
       --m_numFrameStream0InBuffer;
       Ptr<Packet> toRet = outItem->m_packet;
@@ -331,12 +476,11 @@ Ptr<Packet> QuicSocketTxBuffer::NextSequence (uint32_t numBytes,
   NS_LOG_FUNCTION (this << numBytes << seq);
 
 
-  Ptr<QuicSocketTxItem> outItem = GetNewSegment (numBytes, pathId);
+  Ptr<QuicSocketTxItem> outItem = GetNewSegment (numBytes, seq, pathId);
 
   if (outItem != nullptr)
     {
       NS_LOG_INFO ("Extracting " << outItem->m_packet->GetSize () << " bytes");
-      outItem->m_packetNumber = seq;
       outItem->m_lastSent = Now ();
       Ptr<Packet> toRet = outItem->m_packet;
       outItem->m_round = currentRound;
@@ -351,18 +495,23 @@ Ptr<Packet> QuicSocketTxBuffer::NextSequence (uint32_t numBytes,
 }
 
 
-Ptr<QuicSocketTxItem> QuicSocketTxBuffer::GetNewSegment (uint32_t numBytes, uint8_t pathId)
+Ptr<QuicSocketTxItem> QuicSocketTxBuffer::GetNewSegment (uint32_t numBytes, const SequenceNumber32 seq, uint8_t pathId)
 {
-  NS_LOG_FUNCTION (this << numBytes);
+  NS_LOG_FUNCTION (this << numBytes << seq);
 
   Ptr<QuicSocketTxItem> outItem = m_scheduler->GetNewSegment (numBytes,pathId);
+  outItem->m_packetNumber = seq;
 
   if (outItem->m_packet->GetSize () > 0)
     {
       NS_LOG_LOGIC ("Adding packet to sent buffer");
-      m_subflowSentList[pathId].insert (m_subflowSentList[pathId].end (), outItem);
+      m_subflowSentList[pathId].Insert (outItem);
 
       m_sentSizeList[pathId] += outItem->m_packet->GetSize ();
+      if (IsInFlight (outItem))
+        {
+          m_bytesInFlightList[pathId] += outItem->m_packet->GetSize ();
+        }
     }
 
   NS_LOG_INFO (
@@ -376,135 +525,113 @@ Ptr<QuicSocketTxItem> QuicSocketTxBuffer::GetNewSegment (uint32_t numBytes, uint
 // add one agurement pathId
 std::vector<Ptr<QuicSocketTxItem> > QuicSocketTxBuffer::OnAckUpdate (
   Ptr<QuicSocketState> tcb, const uint32_t largestAcknowledged,
-  const std::vector<uint32_t> &additionalAckBlocks,
-  const std::vector<uint32_t> &gaps, uint8_t pathId)
+  const QuicAckBlockList &additionalAckBlocks,
+  const QuicAckBlockList &gaps, uint8_t pathId)
 {
   NS_LOG_FUNCTION (this);
 
-
-  std::vector<uint32_t> compAckBlocks = additionalAckBlocks;
-  std::vector<uint32_t> compGaps = gaps;
-
   std::vector<Ptr<QuicSocketTxItem> > newlyAcked;
   Ptr<QuicSocketState> tcbd = dynamic_cast<QuicSocketState*> (&(*tcb));
 
-  compAckBlocks.insert (compAckBlocks.begin (), largestAcknowledged);
-  uint32_t ackBlockCount = compAckBlocks.size ();
+  NS_LOG_INFO (
+    "Largest ACK: " << largestAcknowledged << ", " << additionalAckBlocks.size () << " additional blocks, " << gaps.size () << " gaps");
 
-  std::vector<uint32_t>::const_iterator ack_it = compAckBlocks.begin ();
-  std::vector<uint32_t>::const_iterator gap_it = compGaps.begin ();
+  QuicSocketTxSentList &sentList = m_subflowSentList[pathId];
 
-  std::stringstream gap_print;
-  for (auto i = gaps.begin (); i != gaps.end (); ++i)
-    {
-      gap_print << (*i) << " ";
-    }
+  // The ACK blocks and the gaps are sorted in decreasing order: block i
+  // acknowledges the packets in (gaps[i], blocks[i]], where blocks[0] is the
+  // largest acknowledged packet and the last block may have no gap
+  uint32_t ackBlockCount = additionalAckBlocks.size () + 1;
+  uint32_t block = 0;
+  SequenceNumber32 blockEnd = SequenceNumber32 (largestAcknowledged);
 
-  std::stringstream block_print;
-  for (auto i = compAckBlocks.begin (); i != compAckBlocks.end (); ++i)
-    {
-      block_print << (*i) << " ";
-    }
+  // Packets are lost as in RFC (Sec. 4.2.1 of draft-ietf-quic-recovery-15)
+  // only if the largest acknowledged packet is in the sent list
+  Ptr<QuicSocketTxItem> ackedItem = sentList.Find (SequenceNumber32 (largestAcknowledged));
+  bool lost = false;
 
-  NS_LOG_INFO (
-    "Largest ACK: " << largestAcknowledged << ", blocks: " << block_print.str () << ", gaps: " << gap_print.str ());
+  // Visit the unacknowledged packets in reverse, from the largest
+  // acknowledged packet, and merge them with the ACK blocks in a single pass:
+  // the packets already acknowledged are skipped, and the lost ones leave the
+  // sent list when they are retransmitted, so the cost does not depend on the
+  // sent list length
+  uint32_t end = sentList.UpperBound (SequenceNumber32 (largestAcknowledged));
+  while ((end = sentList.FindUnacked (end)) > 0)
+    {
+      Ptr<QuicSocketTxItem> item = sentList.At (--end);
 
-  // std::cout<<"Largest ACK: " << largestAcknowledged << ", blocks: " << block_print.str () << ", gaps: " << gap_print.str ()<<std::endl;
+      // Move to the block that can contain the packet
+      while (block < ackBlockCount and block < gaps.size ()
+             and item->m_packetNumber <= SequenceNumber32 (gaps[block]))
+        {
+          ++block;
+          if (block < ackBlockCount)
+            {
+              blockEnd = SequenceNumber32 (additionalAckBlocks[block - 1]);
+              NS_LOG_LOGIC ("ACK block " << block << " ends at " << blockEnd);
+            }
+        }
+      if (block >= ackBlockCount and ackedItem == nullptr)
+        {
+          // Nothing left to acknowledge and no loss detection
+          break;
+        }
 
-  // Iterate over the ACK blocks and gaps
-  for (uint32_t numAckBlockAnalyzed = 0; numAckBlockAnalyzed < ackBlockCount;
-       ++numAckBlockAnalyzed, ++ack_it, ++gap_it)
-    {
-      for (auto sent_it = m_subflowSentList[pathId].rbegin ();
-           sent_it != m_subflowSentList[pathId].rend () and !m_subflowSentList[pathId].empty (); ++sent_it)                    // Visit sentList in reverse Order for optimization
+      if (block < ackBlockCount and item->m_packetNumber <= blockEnd)
         {
-          NS_LOG_LOGIC (
-            "Consider packet " << (*sent_it)->m_packetNumber << " (ACK block " << SequenceNumber32 ((*ack_it)) << ")");
-          // The packet is in the next gap
-          bool inGap = (gap_it < compGaps.end ())
-            && ((*sent_it)->m_packetNumber
-                <= SequenceNumber32 ((*gap_it)));
-          if (inGap)               // Just for optimization we suppose All is perfectly ordered
+          NS_LOG_LOGIC ("Packet " << item->m_packetNumber << " ACKed");
+          if (IsInFlight (item))
             {
-              // (*sent_it)->m_lost = true;
-              NS_LOG_LOGIC (
-                "Packet " << (*sent_it)->m_packetNumber << " missing");
-              break;
+              m_bytesInFlightList[pathId] -= item->m_packet->GetSize ();
             }
-          // The packet is in the current block: ACK it
-          NS_LOG_LOGIC ("Packet " << (*sent_it)->m_packetNumber << " ACKed");
-          bool notInGap =
-            ((gap_it >= compGaps.end ())
-             || ((*sent_it)->m_packetNumber
-                 > SequenceNumber32 ((*gap_it))));
-
-          if ((*sent_it)->m_packetNumber <= SequenceNumber32 ((*ack_it))
-              and notInGap and (*sent_it)->m_sacked == false)
+          if (item->m_lost)
             {
-              (*sent_it)->m_sacked = true;
-              (*sent_it)->m_ackTime = Now ();
-              newlyAcked.push_back ((*sent_it));
-              UpdateRateSample ((*sent_it), tcb);
+              // the loss was spurious: the packet is not retransmitted
+              NS_LOG_INFO ("Packet " << item->m_packetNumber << " ACKed after being marked as lost");
+              item->m_lost = false;
             }
+          item->m_sacked = true;
+          item->m_ackTime = Now ();
+          newlyAcked.push_back (item);
+          UpdateRateSample (item, tcb);
+          continue;
+        }
 
+      NS_LOG_LOGIC ("Packet " << item->m_packetNumber << " missing");
+      if (ackedItem == nullptr or item->m_lost)
+        {
+          continue;
         }
-    }
-  NS_LOG_LOGIC ("Mark lost packets");
-  // Mark packets as lost as in RFC (Sec. 4.2.1 of draft-ietf-quic-recovery-15)
-  uint32_t index = m_subflowSentList[pathId].size ();
-  bool lost = false;
-  bool outstanding = false;
-  auto acked_it = m_subflowSentList[pathId].rend ();
-  // Iterate over the sent packet list in reverse
-  for (auto sent_it = m_subflowSentList[pathId].rbegin ();
-       sent_it != m_subflowSentList[pathId].rend () and !m_subflowSentList[pathId].empty ();
-       ++sent_it, --index)
-    {
       // All previous packets are lost
       if (lost)
         {
-          if (!(*sent_it)->m_sacked)
-            {
-              (*sent_it)->m_lost = true;
-              NS_LOG_LOGIC (
-                "Packet " << (*sent_it)->m_packetNumber << " lost");
-            }
+          item->m_lost = true;
+          NS_LOG_LOGIC (
+            "Packet " << item->m_packetNumber << " lost");
+          continue;
         }
-      else
+      //ACK-based detection
+      if (largestAcknowledged - item->m_packetNumber.GetValue ()
+          >= tcbd->m_kReorderingThreshold)
         {
-          // The packet is the last ACKed packet
-          if ((*sent_it)->m_packetNumber.GetValue () == largestAcknowledged)
-            {
-              // Mark the packet as ACKed
-              acked_it = sent_it;
-              outstanding = true;
-            }
-          else if (outstanding && !(*sent_it)->m_sacked)
+          item->m_lost = true;
+          lost = true;
+          NS_LOG_INFO (
+            "Largest ACK " << largestAcknowledged << ", lost packet " << item->m_packetNumber.GetValue () << " - reordering " << tcbd->m_kReorderingThreshold);
+        }
+      // Time-based detection (optional)
+      if (tcbd->m_kUsingTimeLossDetection)
+        {
+          double lhsComparison = (ackedItem->m_ackTime
+                                  - item->m_lastSent).GetSeconds ();
+          double rhsComparison = tcbd->m_kTimeReorderingFraction
+            * tcbd->m_smoothedRtt.GetSeconds ();
+          if (lhsComparison >= rhsComparison)
             {
-              //ACK-based detection
-              if (largestAcknowledged - (*sent_it)->m_packetNumber.GetValue ()
-                  >= tcbd->m_kReorderingThreshold)
-                {
-                  (*sent_it)->m_lost = true;
-                  lost = true;
-                  NS_LOG_INFO (
-                    "Largest ACK " << largestAcknowledged << ", lost packet " << (*sent_it)->m_packetNumber.GetValue () << " - reordering " << tcbd->m_kReorderingThreshold);
-                }
-              // Time-based detection (optional)
-              if (tcbd->m_kUsingTimeLossDetection)
-                {
-                  double lhsComparison = ((*acked_it)->m_ackTime
-                                          - (*sent_it)->m_lastSent).GetSeconds ();
-                  double rhsComparison = tcbd->m_kTimeReorderingFraction
-                    * tcbd->m_smoothedRtt.GetSeconds ();
-                  if (lhsComparison >= rhsComparison)
-                    {
-                      NS_LOG_UNCOND (
-                        "Largest ACK " << largestAcknowledged << ", lost packet " << (*sent_it)->m_packetNumber.GetValue () << " - time " << rhsComparison);
-                      (*sent_it)->m_lost = true;
-                      lost = true;
-                    }
-                }
+              NS_LOG_UNCOND (
+                "Largest ACK " << largestAcknowledged << ", lost packet " << item->m_packetNumber.GetValue () << " - time " << rhsComparison);
+              item->m_lost = true;
+              lost = true;
             }
         }
     }
@@ -519,16 +646,20 @@ void QuicSocketTxBuffer::ResetSentList (uint8_t pathId, uint32_t keepItems)
 {
   NS_LOG_FUNCTION (this << keepItems);
   uint32_t kept = 0;
+  QuicSocketTxSentList &sentList = m_subflowSentList[pathId];
 
-
-  for (auto sent_it = m_subflowSentList[pathId].rbegin ();
-       sent_it != m_subflowSentList[pathId].rend () and !m_subflowSentList[pathId].empty ();
-       ++sent_it, kept++)
+  for (uint32_t index = sentList.GetSpan (); index-- > 0; )
     {
-      if (kept >= keepItems && !(*sent_it)->m_sacked)
+      Ptr<QuicSocketTxItem> item = sentList.At (index);
+      if (item == nullptr)
+        {
+          continue;
+        }
+      if (kept >= keepItems && !item->m_sacked)
         {
-          (*sent_it)->m_lost = true;
+          item->m_lost = true;
         }
+      kept++;
     }
 }
 
@@ -536,17 +667,13 @@ void QuicSocketTxBuffer::ResetSentList (uint8_t pathId, uint32_t keepItems)
 bool QuicSocketTxBuffer::MarkAsLost (const SequenceNumber32 seq, uint8_t pathId)
 {
   NS_LOG_FUNCTION (this << seq);
-  bool found = false;
-  for (auto sent_it = m_subflowSentList[pathId].begin ();
-       sent_it != m_subflowSentList[pathId].end () and !m_subflowSentList[pathId].empty (); ++sent_it)
+  Ptr<QuicSocketTxItem> item = m_subflowSentList[pathId].Find (seq);
+  if (item == nullptr)
     {
-      if ((*sent_it)->m_packetNumber == seq)
-        {
-          found = true;
-          (*sent_it)->m_lost = true;
-        }
+      return false;
     }
-  return found;
+  item->m_lost = true;
+  return true;
 }
 
 uint32_t QuicSocketTxBuffer::Retransmission (SequenceNumber32 packetNumber, uint8_t pathId)
@@ -554,15 +681,16 @@ uint32_t QuicSocketTxBuffer::Retransmission (SequenceNumber32 packetNumber, uint
   NS_LOG_FUNCTION (this);
   uint32_t toRetx = 0;
 
-  // First pass: add lost packets to the application buffer
-  for (auto sent_it = m_subflowSentList[pathId].rbegin (); sent_it != m_subflowSentList[pathId].rend ();
-       ++sent_it)
+  QuicSocketTxSentList &sentList = m_subflowSentList[pathId];
+
+  // Add lost packets to the application buffer and remove them from the sent list
+  for (uint32_t index = sentList.GetSpan (); index-- > 0; )
     {
-      Ptr<QuicSocketTxItem> item = *sent_it;
-      if (item->m_lost)
+      Ptr<QuicSocketTxItem> item = sentList.At (index);
+      if (item != nullptr && item->m_lost)
         {
           // Add lost packet contents to app buffer
-          Ptr<QuicSocketTxItem> retx = CreateObject<QuicSocketTxItem> ();
+          Ptr<QuicSocketTxItem> retx = Create<QuicSocketTxItem> ();
           retx->m_packetNumber = packetNumber++;
           retx->m_isStream = item->m_isStream;
           retx->m_isStream0 = item->m_isStream0;
@@ -586,25 +714,17 @@ uint32_t QuicSocketTxBuffer::Retransmission (SequenceNumber32 packetNumber, uint
             {
               m_scheduler->Add (retx, true);
             }
-        }
-    }
 
-  NS_LOG_LOGIC ("Remove retransmitted packets from sent list");
-  auto sent_it = m_subflowSentList[pathId].begin ();
-  // Remove lost packets from the sent list
-  while (!m_subflowSentList[pathId].empty () && sent_it != m_subflowSentList[pathId].end ())
-    {
-      Ptr<QuicSocketTxItem> item = *sent_it;
-      if (item->m_lost)
-        {
-          // Remove lost packet from sent vector
-          sent_it = m_subflowSentList[pathId].erase (sent_it);
-        }
-      else
-        {
-          sent_it++;
+          if (IsInFlight (item))
+            {
+              m_bytesInFlightList[pathId] -= item->m_packet->GetSize ();
+            }
+          // Remove lost packet from sent list (slots are visited in reverse, so
+          // the indices still to be visited are not affected)
+          sentList.Erase (index);
         }
     }
+
   return toRetx;
 }
 
@@ -612,15 +732,15 @@ std::vector<Ptr<QuicSocketTxItem> > QuicSocketTxBuffer::DetectLostPackets (uint8
 {
   NS_LOG_FUNCTION (this);
   std::vector<Ptr<QuicSocketTxItem> > lost;
+  const QuicSocketTxSentList &sentList = m_subflowSentList[pathId];
 
-
-  for (auto sent_it = m_subflowSentList[pathId].begin ();
-       sent_it != m_subflowSentList[pathId].end () and !m_subflowSentList[pathId].empty (); ++sent_it)
+  for (uint32_t index = 0; index < sentList.GetSpan (); ++index)
     {
-      if ((*sent_it)->m_lost)
+      Ptr<QuicSocketTxItem> item = sentList.At (index);
+      if (item != nullptr && item->m_lost)
         {
-          lost.push_back ((*sent_it));
-          NS_LOG_INFO ("Packet " << (*sent_it)->m_packetNumber << " is lost");
+          lost.push_back (item);
+          NS_LOG_INFO ("Packet " << item->m_packetNumber << " is lost");
         }
     }
   return lost;
@@ -630,14 +750,14 @@ uint32_t QuicSocketTxBuffer::GetLost (uint8_t pathId)
 {
   NS_LOG_FUNCTION (this);
   uint32_t lostCount = 0;
+  const QuicSocketTxSentList &sentList = m_subflowSentList[pathId];
 
-
-  for (auto sent_it = m_subflowSentList[pathId].begin ();
-       sent_it != m_subflowSentList[pathId].end () and !m_subflowSentList[pathId].empty (); ++sent_it)
+  for (uint32_t index = 0; index < sentList.GetSpan (); ++index)
     {
-      if ((*sent_it)->m_lost)
+      Ptr<QuicSocketTxItem> item = sentList.At (index);
+      if (item != nullptr && item->m_lost)
         {
-          lostCount += (*sent_it)->m_packet->GetSize ();
+          lostCount += item->m_packet->GetSize ();
         }
     }
   return lostCount;
@@ -646,18 +766,17 @@ uint32_t QuicSocketTxBuffer::GetLost (uint8_t pathId)
 void QuicSocketTxBuffer::CleanSentList (uint8_t pathId)
 {
   NS_LOG_FUNCTION (this);
-  auto sent_it = m_subflowSentList[pathId].begin ();
+  QuicSocketTxSentList &sentList = m_subflowSentList[pathId];
   // All packets up to here are ACKed (already sent to the receiver app)
-  while (!m_subflowSentList[pathId].empty () && (*sent_it)->m_sacked && !(*sent_it)->m_lost)
+  while (!sentList.IsEmpty () && sentList.At (0)->m_sacked && !sentList.At (0)->m_lost)
     {
-      // Remove ACKed packet from sent vector
-      Ptr<QuicSocketTxItem> item = *sent_it;
+      // Remove ACKed packet from sent list
+      Ptr<QuicSocketTxItem> item = sentList.At (0);
       item->m_acked = true;
       m_sentSizeList[pathId] -= item->m_packet->GetSize ();
-      m_subflowSentList[pathId].erase (sent_it);
+      sentList.Erase (0);
       NS_LOG_LOGIC (
-        "Packet " << (*sent_it)->m_packetNumber << " received and ACKed. Removing from sent buffer");
-      sent_it = m_subflowSentList[pathId].begin ();
+        "Packet " << item->m_packetNumber << " received and ACKed. Removing from sent buffer");
     }
 }
 
@@ -687,26 +806,46 @@ uint32_t QuicSocketTxBuffer::GetNumFrameStream0InBuffer (void) const
 }
 
 
-uint32_t QuicSocketTxBuffer::BytesInFlight (uint8_t pathId) 
+uint32_t QuicSocketTxBuffer::BytesInFlight (uint8_t pathId)
 {
   NS_LOG_FUNCTION (this);
 
-  uint32_t inFlight = 0;
+  uint32_t inFlight = m_bytesInFlightList[pathId];
+
+  if (m_validateBytesInFlight)
+    {
+      uint32_t scanned = ScanBytesInFlight (pathId);
+      NS_ABORT_MSG_IF (inFlight != scanned,
+                       "Bytes in flight counter on path " << (uint16_t) pathId << " is " << inFlight
+                                                          << ", sent list holds " << scanned);
+    }
+
+  NS_LOG_INFO ("Compute bytes in flight " << inFlight << " m_sentSize " << m_sentSizeList[pathId] << " m_appSize " << m_streamZeroSize + m_scheduler->AppSize ());
+  return inFlight;
+
+}
+
+uint32_t QuicSocketTxBuffer::ScanBytesInFlight (uint8_t pathId) const
+{
+  NS_LOG_FUNCTION (this);
 
+  uint32_t inFlight = 0;
+  const QuicSocketTxSentList &sentList = m_subflowSentList[pathId];
 
-  for (auto sent_it = m_subflowSentList[pathId].begin ();
-       sent_it != m_subflowSentList[pathId].end () and !m_subflowSentList[pathId].empty (); ++sent_it)
+  for (uint32_t index = 0; index < sentList.GetSpan (); ++index)
     {
-      if (!(*sent_it)->m_isStream0 && (*sent_it)->m_isStream
-          && !(*sent_it)->m_sacked)
+      Ptr<QuicSocketTxItem> item = sentList.At (index);
+      if (item != nullptr && IsInFlight (item))
         {
-          inFlight += (*sent_it)->m_packet->GetSize ();
+          inFlight += item->m_packet->GetSize ();
         }
     }
-
-  NS_LOG_INFO ("Compute bytes in flight " << inFlight << " m_sentSize " << m_sentSizeList[pathId] << " m_appSize " << m_streamZeroSize + m_scheduler->AppSize ());
   return inFlight;
+}
 
+bool QuicSocketTxBuffer::IsInFlight (Ptr<const QuicSocketTxItem> item)
+{
+  return !item->m_isStream0 && item->m_isStream && !item->m_sacked;
 }
 
 // void QuicSocketTxBuffer::SetQuicSocketState (Ptr<QuicSocketState> tcb)
@@ -726,7 +865,24 @@ void QuicSocketTxBuffer::UpdatePacketSent (SequenceNumber32 seq, uint32_t sz, ui
   NS_LOG_FUNCTION (this << seq << sz);
   Ptr<QuicSocketState> m_tcb = tcb;
 
-  if (m_tcb == nullptr or sz == 0)
+  if (sz == 0)
+    {
+      return;
+    }
+
+  Ptr<QuicSocketTxItem> item = m_subflowSentList[pathId].Find (seq);
+  NS_ASSERT_MSG (item != nullptr, "not found seq " << seq);
+
+  // The socket may have piggybacked an ACK frame on the packet after it was
+  // moved to the sent list: account for it in the per-path counters
+  uint32_t piggybacked = item->m_packet->GetSize () - sz;
+  m_sentSizeList[pathId] += piggybacked;
+  if (IsInFlight (item))
+    {
+      m_bytesInFlightList[pathId] += piggybacked;
+    }
+
+  if (m_tcb == nullptr)
     {
       return;
     }
@@ -737,16 +893,6 @@ void QuicSocketTxBuffer::UpdatePacketSent (SequenceNumber32 seq, uint32_t sz, ui
       m_tcb->m_deliveredTime = Simulator::Now ();
     }
 
-  Ptr<QuicSocketTxItem> item = nullptr;
-  for (auto it = m_subflowSentList[pathId].rbegin (); it != m_subflowSentList[pathId].rend (); ++it)
-    {
-      if ((*it)->m_packetNumber == seq)
-        {
-          item = *it;
-          break;
-        }
-    }
-  NS_ASSERT_MSG (item != nullptr, "not found seq " << seq);
   item->m_firstSentTime = m_tcb->m_firstSentTime;
   item->m_deliveredTime = m_tcb->m_deliveredTime;
   item->m_isAppLimited = (m_tcb->m_appLimitedUntil > m_tcb->m_delivered);
@@ -884,16 +1030,57 @@ Time QuicSocketTxBuffer::GetDefaultLatency ()
   return GetLatency (0);
 }
 
+Time QuicSocketTxBuffer::GetHeadDeadline ()
+{
+  // Only relevant for the EDF scheduler
+  if (m_scheduler->GetTypeId () == QuicSocketTxEdfScheduler::GetTypeId ())
+    {
+      return (DynamicCast<QuicSocketTxEdfScheduler> (m_scheduler))->GetHeadDeadline ();
+    }
+  else
+    {
+      return Time::Max ();
+    }
+}
+
+void QuicSocketTxBuffer::DeprioritizeLateFrames (Time deliveryTime)
+{
+  // Only relevant for the EDF scheduler
+  if (m_scheduler->GetTypeId () == QuicSocketTxEdfScheduler::GetTypeId ())
+    {
+      (DynamicCast<QuicSocketTxEdfScheduler> (m_scheduler))->DeprioritizeLateFrames (deliveryTime);
+    }
+}
+
+void QuicSocketTxBuffer::SetStreamWeight (uint64_t streamId, uint32_t weight)
+{
+  // Only relevant for the DRR scheduler
+  if (m_scheduler->GetTypeId () == QuicSocketTxDrrScheduler::GetTypeId ())
+    {
+      (DynamicCast<QuicSocketTxDrrScheduler> (m_scheduler))->SetWeight (streamId, weight);
+    }
+}
+
+void QuicSocketTxBuffer::SetStreamPriorityClass (uint64_t streamId, uint8_t priorityClass)
+{
+  // Only relevant for the DRR scheduler
+  if (m_scheduler->GetTypeId () == QuicSocketTxDrrScheduler::GetTypeId ())
+    {
+      (DynamicCast<QuicSocketTxDrrScheduler> (m_scheduler))->SetPriorityClass (streamId, priorityClass);
+    }
+}
+
 
 //For multipath implementation
 
 void QuicSocketTxBuffer::AddSentList(uint8_t pathId)
 {
     while (m_subflowSentList.size() <= pathId){
-      QuicTxPacketList sentList = QuicTxPacketList();
+      QuicSocketTxSentList sentList = QuicSocketTxSentList();
       m_subflowSentList.insert(m_subflowSentList.end(), sentList);
       uint32_t sentSize = 0;
       m_sentSizeList.insert(m_sentSizeList.end(), sentSize);
+      m_bytesInFlightList.insert(m_bytesInFlightList.end(), 0);
     }
 }
 
@@ -902,7 +1089,7 @@ int QuicSocketTxBuffer::SentListIsEmpty()
 {
   NS_LOG_FUNCTION (this);
   for (uint8_t pid = 0; pid < m_subflowSentList.size(); pid++){
-    if (!m_subflowSentList[pid].empty()) {
+    if (!m_subflowSentList[pid].IsEmpty()) {
       return false;
     }
   }
@@ -28,6 +28,7 @@
 #define QUICSOCKETTXBUFFER_H
 
 #include "ns3/object.h"
+#include "ns3/simple-ref-count.h"
 #include "ns3/traced-value.h"
 #include "ns3/sequence-number.h"
 #include "ns3/nstime.h"
@@ -36,6 +37,8 @@
 #include "ns3/tcp-socket-base.h"
 #include "ns3/data-rate.h"
 #include "quic-socket-tx-scheduler.h"
+#include "quic-item-pool.h"
+#include <deque>
 
 namespace ns3 {
 
@@ -62,18 +65,42 @@ struct RateSample
  * \ingroup quic
  *
  * \brief Item that encloses the application packet and some flags for it
+ *
+ * An item is created for every frame and every sent packet, so it is a
+ * reference-counted record rather than an Object, and its memory is
+ * recycled through a QuicItemPool when the last reference is dropped
+ * (e.g., when the acknowledged items are removed from the sent list).
  */
-class QuicSocketTxItem : public Object
+class QuicSocketTxItem : public SimpleRefCount<QuicSocketTxItem>
 {
 public:
+  QuicSocketTxItem ();
+  QuicSocketTxItem (const QuicSocketTxItem &other);
   /**
-   * \brief Get the type ID.
-   * \return the object TypeId
+   * \brief Copy the bookkeeping of an item, with another packet
+   *
+   * Unlike the copy constructor, the packet of the other item is not copied
+   *
+   * \param other the item to copy
+   * \param packet the packet of the new item (e.g., a fragment of the packet of other)
    */
-  static TypeId GetTypeId (void);
+  QuicSocketTxItem (const QuicSocketTxItem &other, Ptr<Packet> packet);
 
-  QuicSocketTxItem ();
-  QuicSocketTxItem (const QuicSocketTxItem &other);
+  /**
+   * \brief Allocate an item from the item pool
+   *
+   * \param size the size of the item
+   * \return the memory for the item
+   */
+  static void * operator new (std::size_t size);
+
+  /**
+   * \brief Return the memory of an item to the item pool
+   *
+   * \param p the memory of the item
+   * \param size the size of the item
+   */
+  static void operator delete (void *p, std::size_t size);
 
   /**
    * \brief Merge two QuicSocketTxItem
@@ -117,6 +144,107 @@ public:
   uint32_t m_round { 0 };       //!< Connection's ACK-only bytes sent at the time the packet was sent
 };
 
+/**
+ * \ingroup quic
+ *
+ * \brief Packets sent on a path, indexed by packet number
+ *
+ * Packet numbers are strictly increasing on each path, so the items are kept
+ * in a deque at the offset of their packet number from the oldest tracked
+ * packet. Packet numbers that are not tracked (e.g., ACK-only packets or
+ * packets removed for retransmission) leave an empty slot. The first slot is
+ * always occupied, so the index of an item only changes when the first item
+ * is removed.
+ */
+class QuicSocketTxSentList
+{
+public:
+  QuicSocketTxSentList ();
+
+  /**
+   * \brief Append an item after the last tracked packet number
+   *
+   * \param item the item, with its packet number already set
+   */
+  void Insert (Ptr<QuicSocketTxItem> item);
+
+  /**
+   * \brief Empty the slot at the given index
+   *
+   * If the slot is the first one, the leading empty slots are released and
+   * the index of all the other items changes.
+   *
+   * \param index the slot index
+   */
+  void Erase (uint32_t index);
+
+  /**
+   * \brief Get the item in a slot
+   *
+   * \param index the slot index
+   * \return the item, or 0 if the slot is empty
+   */
+  Ptr<QuicSocketTxItem> At (uint32_t index) const;
+
+  /**
+   * \brief Find an item by packet number
+   *
+   * \param seq the packet number
+   * \return the item, or 0 if the packet number is not tracked
+   */
+  Ptr<QuicSocketTxItem> Find (SequenceNumber32 seq) const;
+
+  /**
+   * \brief Get the number of slots holding packet numbers not greater than seq
+   *
+   * The slots in [UpperBound (lo), UpperBound (hi)) hold the range (lo, hi].
+   *
+   * \param seq the packet number
+   * \return the index of the first slot after seq
+   */
+  uint32_t UpperBound (SequenceNumber32 seq) const;
+
+  /**
+   * \brief Find the last item not acknowledged yet before a slot
+   *
+   * Acknowledged items are never unacknowledged again, so runs of them are
+   * skipped through per-slot links that are shortened by each call. Lost
+   * items are still returned, as a late ACK may acknowledge them before they
+   * are retransmitted.
+   *
+   * \param end the slot after the last one to consider
+   * \return the slot of the item plus one, or 0 if there is none
+   */
+  uint32_t FindUnacked (uint32_t end);
+
+  /**
+   * \return the number of slots, including the empty ones
+   */
+  uint32_t GetSpan () const;
+
+  /**
+   * \return the number of items
+   */
+  uint32_t GetSize () const;
+
+  /**
+   * \return true if there are no items
+   */
+  bool IsEmpty () const;
+
+private:
+  /**
+   * \param index the slot index
+   * \return the slot after the last one that may hold an unacknowledged item before the slot
+   */
+  uint32_t GetLinkEnd (uint32_t index) const;
+
+  std::deque<Ptr<QuicSocketTxItem> > m_slots;  //!< Items, indexed by packet number offset
+  std::deque<SequenceNumber32> m_links;        //!< For each slot, the packet number after the last one that may be unacknowledged before it
+  SequenceNumber32 m_first;                    //!< Packet number of the first slot
+  uint32_t m_size;                             //!< Number of occupied slots
+};
+
 /**
  * \ingroup quic
  *
@@ -175,10 +303,11 @@ public:
    * \brief Get a block of data not transmitted yet and move it into SentList
    *
    * \param numBytes number of bytes of the QuicSocketTxItem requested
+   * \param seq the packet number of the block
    * \param pathId the path on which the packet will be sent 
    * \return the item that contains the right packet
    */
-  Ptr<QuicSocketTxItem> GetNewSegment (uint32_t numBytes, uint8_t pathId);
+  Ptr<QuicSocketTxItem> GetNewSegment (uint32_t numBytes, const SequenceNumber32 seq, uint8_t pathId);
 
   /**
    * Process an acknowledgment, set the packets in the send buffer as acknowledged, mark
@@ -195,8 +324,8 @@ public:
    */
   std::vector<Ptr<QuicSocketTxItem> > OnAckUpdate (Ptr<QuicSocketState> tcb,
                                                    const uint32_t largestAcknowledged,
-                                                   const std::vector<uint32_t> &additionalAckBlocks,
-                                                   const std::vector<uint32_t> &gaps,
+                                                   const QuicAckBlockList &additionalAckBlocks,
+                                                   const QuicAckBlockList &gaps,
                                                    uint8_t pathId);
 
   /**
@@ -244,6 +373,11 @@ public:
   /**
    * \brief Return total bytes in flight
    *
+   * The value is read from a per-path counter maintained as packets enter the
+   * sent list, are acknowledged or are removed for retransmission. Lost packets
+   * are still in flight until they are retransmitted.
+   *
+   * \param pathId the path ID
    * \returns total bytes in flight
    */
   uint32_t BytesInFlight (uint8_t pathId);
@@ -365,6 +499,36 @@ public:
    */
   Time GetDefaultLatency ();
 
+  /**
+   * Get the deadline of the next frame to be sent
+   *
+   * \return The deadline, or Time::Max () if the scheduler has no deadlines
+   */
+  Time GetHeadDeadline ();
+
+  /**
+   * Move the frames that cannot meet their deadline behind the other ones
+   *
+   * \param deliveryTime The earliest time at which a frame sent now can be delivered
+   */
+  void DeprioritizeLateFrames (Time deliveryTime);
+
+  /**
+   * Set the weight of a stream for the weighted fair queueing scheduler
+   *
+   * \param streamId The stream ID
+   * \param weight The stream's weight
+   */
+  void SetStreamWeight (uint64_t streamId, uint32_t weight);
+
+  /**
+   * Set the strict priority class of a stream for the weighted fair queueing scheduler
+   *
+   * \param streamId The stream ID
+   * \param priorityClass The stream's class (the lowest class is served first)
+   */
+  void SetStreamPriorityClass (uint64_t streamId, uint8_t priorityClass);
+
 
   //For multipath Implementation
   
@@ -380,6 +544,24 @@ private:
    */
   void CleanSentList (uint8_t pathId);
 
+  /**
+   * \brief Compute the bytes in flight by scanning the sent list
+   *
+   * Used to validate the per-path counters when ValidateBytesInFlight is set
+   *
+   * \param pathId the path ID
+   * \return the bytes in flight on the path
+   */
+  uint32_t ScanBytesInFlight (uint8_t pathId) const;
+
+  /**
+   * \brief Check if an item in the sent list counts as in flight
+   *
+   * \param item the item
+   * \return true for unacknowledged stream frames (except stream 0)
+   */
+  static bool IsInFlight (Ptr<const QuicSocketTxItem> item);
+
 
   QuicTxPacketList m_streamZeroList;       //!< List of waiting stream 0 packets with additional info
   uint32_t m_maxBuffer;            //!< Max number of data bytes in buffer (SND.WND)
@@ -394,8 +576,10 @@ private:
 
   //For multipath Implementation
 
-  std::vector<QuicTxPacketList> m_subflowSentList;
+  std::vector<QuicSocketTxSentList> m_subflowSentList;      //!< Sent packets of each path
   std::vector<uint32_t> m_sentSizeList;                       //!< Size of all data in the sent list
+  std::vector<uint32_t> m_bytesInFlightList;                  //!< Bytes in flight on each path
+  bool m_validateBytesInFlight;                               //!< Cross-check the counters against the sent list
   
   /**
    * pass m_sentList 0 or m_sentList1 by reference to m_sentList
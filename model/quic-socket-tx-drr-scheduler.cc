@@ -0,0 +1,241 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Pan Lab, Department of Computer Science, University of Victoria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "quic-socket-tx-drr-scheduler.h"
+
+#include <algorithm>
+
+#include "ns3/packet.h"
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include "ns3/boolean.h"
+#include "ns3/uinteger.h"
+#include "quic-socket-tx-buffer.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("QuicSocketTxDrrScheduler");
+
+NS_OBJECT_ENSURE_REGISTERED (QuicSocketTxDrrScheduler);
+
+TypeId QuicSocketTxDrrScheduler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::QuicSocketTxDrrScheduler")
+    .SetParent<QuicSocketTxScheduler> ()
+    .SetGroupName ("Internet")
+    .AddConstructor<QuicSocketTxDrrScheduler> ()
+    .AddAttribute ("RetxFirst", "Prioritize retransmissions regardless of stream",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&QuicSocketTxDrrScheduler::m_retxFirst),
+                   MakeBooleanChecker ())
+    .AddAttribute ("Quantum", "Bytes a stream of weight 1 can send in each round",
+                   UintegerValue (1200),
+                   MakeUintegerAccessor (&QuicSocketTxDrrScheduler::m_quantum),
+                   MakeUintegerChecker<uint32_t> (1))
+  ;
+  return tid;
+}
+
+QuicSocketTxDrrScheduler::QuicSocketTxDrrScheduler () :
+  QuicSocketTxScheduler (), m_retxFirst (false), m_quantum (1200)
+{}
+
+QuicSocketTxDrrScheduler::QuicSocketTxDrrScheduler (
+  const QuicSocketTxDrrScheduler &other) :
+  QuicSocketTxScheduler (other), m_retxFirst (other.m_retxFirst),
+  m_quantum (other.m_quantum), m_streams (other.m_streams),
+  m_rings (other.m_rings), m_retxList (other.m_retxList)
+{}
+
+QuicSocketTxDrrScheduler::~QuicSocketTxDrrScheduler (void)
+{}
+
+QuicSocketTxDrrScheduler::DrrStreamQueue &
+QuicSocketTxDrrScheduler::GetDrrStreamQueue (uint64_t streamId)
+{
+  // the states are kept for the whole connection, so weights and classes can
+  // be set before the stream sends anything
+  return m_streams[streamId];
+}
+
+void
+QuicSocketTxDrrScheduler::AddScheduleItem (Ptr<QuicSocketTxScheduleItem> item, bool retx)
+{
+  NS_LOG_FUNCTION (this << item << retx);
+  m_appSize += item->GetSize ();
+  NS_LOG_INFO ("Adding packet on stream " << item->GetStreamId () << " with offset " << item->GetOffset ());
+
+  if (retx and m_retxFirst)
+    {
+      m_retxList.push_back (item);
+      return;
+    }
+
+  DrrStreamQueue &queue = GetDrrStreamQueue (item->GetStreamId ());
+  if (retx)
+    {
+      // retransmissions go before the new data of the stream, by offset
+      auto it = queue.m_items.begin ();
+      while (it != queue.m_items.end () and (*it)->GetPriority () < 0
+             and (*it)->GetOffset () < item->GetOffset ())
+        {
+          ++it;
+        }
+      queue.m_items.insert (it, item);
+    }
+  else
+    {
+      queue.m_items.push_back (item);
+    }
+
+  if (!queue.m_active)
+    {
+      queue.m_active = true;
+      queue.m_deficit = 0;
+      m_rings[queue.m_class].push_back (item->GetStreamId ());
+    }
+}
+
+Ptr<QuicSocketTxScheduleItem>
+QuicSocketTxDrrScheduler::PopScheduleItem ()
+{
+  NS_LOG_FUNCTION (this);
+  Ptr<QuicSocketTxScheduleItem> item = nullptr;
+
+  if (!m_retxList.empty ())
+    {
+      item = m_retxList.front ();
+      m_retxList.pop_front ();
+    }
+  else if (!m_rings.empty ())
+    {
+      std::deque<uint64_t> &ring = m_rings.begin ()->second;
+      DrrStreamQueue *queue = &m_streams.find (ring.front ())->second;
+
+      // a stream without credit gets its quantum and goes to the end of the
+      // ring; it may send as long as its deficit is positive, so a frame
+      // larger than the quantum does not stall the ring
+      while (queue->m_deficit <= 0)
+        {
+          queue->m_deficit += (int64_t) m_quantum * queue->m_weight;
+          ring.push_back (ring.front ());
+          ring.pop_front ();
+          queue = &m_streams.find (ring.front ())->second;
+        }
+
+      item = queue->m_items.front ();
+      queue->m_items.pop_front ();
+      queue->m_deficit -= item->GetSize ();
+      if (queue->m_items.empty ())
+        {
+          queue->m_active = false;
+          ring.pop_front ();
+          if (ring.empty ())
+            {
+              m_rings.erase (m_rings.begin ());
+            }
+        }
+    }
+
+  if (item != nullptr)
+    {
+      m_appSize -= item->GetSize ();
+      NS_LOG_INFO ("Extracted packet on stream " << item->GetStreamId () << " with offset " << item->GetOffset ());
+    }
+  return item;
+}
+
+void
+QuicSocketTxDrrScheduler::ReturnScheduleItem (Ptr<QuicSocketTxScheduleItem> item)
+{
+  NS_LOG_FUNCTION (this << item);
+  uint32_t size = item->GetSize ();
+  m_appSize += size;
+
+  if (item->GetPriority () < 0 and m_retxFirst)
+    {
+      m_retxList.push_front (item);
+      return;
+    }
+
+  // the stream is only charged for the bytes actually sent
+  DrrStreamQueue &queue = GetDrrStreamQueue (item->GetStreamId ());
+  queue.m_deficit += size;
+  queue.m_items.push_front (item);
+  if (!queue.m_active)
+    {
+      queue.m_active = true;
+      m_rings[queue.m_class].push_front (item->GetStreamId ());
+    }
+}
+
+void
+QuicSocketTxDrrScheduler::SetWeight (uint64_t streamId, uint32_t weight)
+{
+  NS_LOG_FUNCTION (this << streamId << weight);
+  NS_ABORT_MSG_IF (weight == 0, "The weight of stream " << streamId << " must be at least 1");
+  GetDrrStreamQueue (streamId).m_weight = weight;
+}
+
+uint32_t
+QuicSocketTxDrrScheduler::GetWeight (uint64_t streamId) const
+{
+  auto it = m_streams.find (streamId);
+  if (it == m_streams.end ())
+    {
+      return 1;
+    }
+  return it->second.m_weight;
+}
+
+void
+QuicSocketTxDrrScheduler::SetPriorityClass (uint64_t streamId, uint8_t priorityClass)
+{
+  NS_LOG_FUNCTION (this << streamId << (uint16_t) priorityClass);
+  DrrStreamQueue &queue = GetDrrStreamQueue (streamId);
+  if (queue.m_class == priorityClass)
+    {
+      return;
+    }
+
+  if (queue.m_active)
+    {
+      auto ringIt = m_rings.find (queue.m_class);
+      ringIt->second.erase (std::find (ringIt->second.begin (), ringIt->second.end (), streamId));
+      if (ringIt->second.empty ())
+        {
+          m_rings.erase (ringIt);
+        }
+      m_rings[priorityClass].push_back (streamId);
+    }
+  queue.m_class = priorityClass;
+}
+
+uint8_t
+QuicSocketTxDrrScheduler::GetPriorityClass (uint64_t streamId) const
+{
+  auto it = m_streams.find (streamId);
+  if (it == m_streams.end ())
+    {
+      return 0;
+    }
+  return it->second.m_class;
+}
+
+}
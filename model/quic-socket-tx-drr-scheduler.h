@@ -0,0 +1,127 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Pan Lab, Department of Computer Science, University of Victoria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef QUICSOCKETTXDRRSCHEDULER_H
+#define QUICSOCKETTXDRRSCHEDULER_H
+
+#include "quic-socket-tx-scheduler.h"
+#include <deque>
+#include <map>
+#include <unordered_map>
+
+namespace ns3 {
+
+/**
+ * \brief The weighted fair queueing implementation
+ *
+ * This class is a Deficit Round Robin implementation of the socket scheduler.
+ * Each stream has its own FIFO queue; streams are grouped in strict priority
+ * classes (the lowest class is served first), and the active streams of a
+ * class share the link in proportion to their weights. Adding and extracting
+ * a frame take constant amortized time, independent of the number of
+ * buffered frames.
+ */
+class QuicSocketTxDrrScheduler : public QuicSocketTxScheduler
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  QuicSocketTxDrrScheduler ();
+  QuicSocketTxDrrScheduler (const QuicSocketTxDrrScheduler &other);
+  virtual ~QuicSocketTxDrrScheduler (void);
+
+  /**
+   * Add a schedule tx item to the queue of its stream
+   *
+   * \param item a scheduling item
+   * \param retx true if the item is being retransmitted
+   */
+  void AddScheduleItem (Ptr<QuicSocketTxScheduleItem> item, bool retx) override;
+
+  /**
+   * Set the weight of a stream within its priority class
+   *
+   * \param streamId The stream ID
+   * \param weight The stream's weight (at least 1)
+   */
+  void SetWeight (uint64_t streamId, uint32_t weight);
+
+  /**
+   * Get the weight of a stream
+   *
+   * \param streamId The stream ID
+   * \return The stream's weight, or 1 if the stream is not registered
+   */
+  uint32_t GetWeight (uint64_t streamId) const;
+
+  /**
+   * Set the strict priority class of a stream
+   *
+   * \param streamId The stream ID
+   * \param priorityClass The stream's class (the lowest class is served first)
+   */
+  void SetPriorityClass (uint64_t streamId, uint8_t priorityClass);
+
+  /**
+   * Get the strict priority class of a stream
+   *
+   * \param streamId The stream ID
+   * \return The stream's class, or 0 if the stream is not registered
+   */
+  uint8_t GetPriorityClass (uint64_t streamId) const;
+
+protected:
+  Ptr<QuicSocketTxScheduleItem> PopScheduleItem () override;
+  void ReturnScheduleItem (Ptr<QuicSocketTxScheduleItem> item) override;
+
+private:
+  /**
+   * \brief Queue and scheduling state of a stream
+   */
+  struct DrrStreamQueue
+  {
+    std::deque<Ptr<QuicSocketTxScheduleItem> > m_items;  //!< Frames of the stream, in sending order
+    uint32_t m_weight {1};                               //!< Weight within the priority class
+    uint8_t m_class {0};                                 //!< Strict priority class
+    int64_t m_deficit {0};                               //!< Bytes the stream can still send in this round
+    bool m_active {false};                               //!< True if the stream is in the ring of its class
+  };
+
+  /**
+   * \brief Get the state of a stream, creating it if needed
+   *
+   * \param streamId The stream ID
+   * \return the stream state
+   */
+  DrrStreamQueue & GetDrrStreamQueue (uint64_t streamId);
+
+  bool m_retxFirst;                                          //!< Send retransmissions before any other frame
+  uint32_t m_quantum;                                        //!< Bytes added to the deficit of a stream of weight 1 in each round
+  std::unordered_map<uint64_t, DrrStreamQueue> m_streams;    //!< Stream states, by stream ID
+  std::map<uint8_t, std::deque<uint64_t> > m_rings;          //!< Active streams of each non-empty priority class
+  std::deque<Ptr<QuicSocketTxScheduleItem> > m_retxList;     //!< Retransmissions sent first, if m_retxFirst is set
+};
+
+} // namepsace ns3
+
+#endif /* QUIC_SOCKET_TX_DRR_SCHEDULER_H */
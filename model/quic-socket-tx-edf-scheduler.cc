@@ -50,12 +50,17 @@ TypeId QuicSocketTxEdfScheduler::GetTypeId (void)
                    BooleanValue (false),
                    MakeBooleanAccessor (&QuicSocketTxEdfScheduler::m_retxFirst),
                    MakeBooleanChecker ())
+    .AddAttribute ("LatePenalty",
+                   "Deadline postponement of the frames that cannot meet their deadline on any path (0 to disable)",
+                   TimeValue (Seconds (3600)),
+                   MakeTimeAccessor (&QuicSocketTxEdfScheduler::m_latePenalty),
+                   MakeTimeChecker ())
   ;
   return tid;
 }
 
 QuicSocketTxEdfScheduler::QuicSocketTxEdfScheduler () :
-  QuicSocketTxScheduler (), m_retxFirst (false)
+  QuicSocketTxScheduler (), m_retxFirst (false), m_latePenalty (Seconds (3600))
 {
   m_defaultLatency = Seconds (0.1);
 }
@@ -63,7 +68,7 @@ QuicSocketTxEdfScheduler::QuicSocketTxEdfScheduler () :
 QuicSocketTxEdfScheduler::QuicSocketTxEdfScheduler (
   const QuicSocketTxEdfScheduler &other) :
   QuicSocketTxScheduler (other), m_retxFirst (
-    other.m_retxFirst)
+    other.m_retxFirst), m_latePenalty (other.m_latePenalty)
 {
   m_defaultLatency = other.m_defaultLatency;
   m_latencyMap = other.m_latencyMap;
@@ -83,7 +88,7 @@ void QuicSocketTxEdfScheduler::Add (Ptr<QuicSocketTxItem> item, bool retx)
           QuicSubheader sub;
           item->m_packet->PeekHeader (sub);
           NS_LOG_INFO ("Adding retransmitted packet with highest priority");
-          AddScheduleItem (CreateObject<QuicSocketTxScheduleItem> (sub.GetStreamId (), sub.GetOffset (), -1, item), retx);
+          AddScheduleItem (Create<QuicSocketTxScheduleItem> (sub.GetStreamId (), sub.GetOffset (), -1, item), retx);
         }
       else
         {
@@ -96,45 +101,45 @@ void QuicSocketTxEdfScheduler::Add (Ptr<QuicSocketTxItem> item, bool retx)
 
               NS_LOG_INFO (
                 "Disgregate packet to be retransmitted" << dataSizeByte << "; first fragment size" << sub.GetSerializedSize () + sub.GetLength ());
-              Ptr<Packet> remaining = item->m_packet->Copy ();
 
               // the packet could contain multiple frames
               // each of them starts with a subheader
-              // cycle through the data packet and extract the frames
-              for (uint32_t start = 0; start < dataSizeByte;)
+              // cycle through the data packet and slice the frames out of
+              // it: the fragments share its buffer and the last one reuses
+              // the packet and the item themselves
+              Ptr<Packet> remaining = item->m_packet;
+              while (remaining->GetSize () > 0)
                 {
-                  item->m_packet->RemoveHeader (sub);
-                  Ptr<Packet> nextFragment = Create<Packet> ();
-                  if (sub.IsStream ())
+                  remaining->RemoveHeader (sub);
+                  uint32_t length = sub.IsStream () ? sub.GetLength () : 0;
+                  NS_LOG_INFO (
+                    "subheader " << sub << " dataSizeByte " << dataSizeByte << " remaining " << remaining->GetSize () << " frame size " << length);
+
+                  Ptr<QuicSocketTxItem> it = item;
+                  if (length < remaining->GetSize ())
                     {
-                      NS_LOG_INFO (
-                        "subheader " << sub << " dataSizeByte " << dataSizeByte << " remaining " << item->m_packet->GetSize () << " frame size " << sub.GetLength ());
-                      nextFragment = item->m_packet->Copy ();
-                      NS_LOG_INFO ("fragment size " << nextFragment->GetSize () << " " << sub.GetLength ());
-                      nextFragment->RemoveAtEnd (
-                        nextFragment->GetSize () - sub.GetLength ());
-                      NS_LOG_INFO ("fragment size " << nextFragment->GetSize ());
-
-                      // remove the first portion of the packet
-                      item->m_packet->RemoveAtStart (sub.GetLength ());
+                      it = Create<QuicSocketTxItem> (*item, remaining->CreateFragment (0, length));
+                      remaining->RemoveAtStart (length);
                     }
-                  nextFragment->AddHeader (sub);
-                  start += nextFragment->GetSize ();
-                  Ptr<QuicSocketTxItem> it = CreateObject<QuicSocketTxItem> (
-                    *item);
+                  it->m_packet->AddHeader (sub);
+
                   uint64_t streamId = sub.GetStreamId ();
                   uint64_t offset = sub.GetOffset ();
-                  it->m_packet = nextFragment;
                   NS_LOG_INFO (
                     "Added retx fragment on stream " << streamId << " with offset " << offset << " and length " << it->m_packet->GetSize () << ", pointer " << GetPointer (it->m_packet));
-                  AddScheduleItem (CreateObject<QuicSocketTxScheduleItem> (streamId, offset, GetDeadline (it).GetSeconds (), it), false);
+                  Time deadline = it->m_generated + GetLatency (streamId);
+                  AddScheduleItem (Create<QuicSocketTxScheduleItem> (streamId, offset, deadline.GetSeconds (), it), false);
+                  if (it == item)
+                    {
+                      break;
+                    }
                 }
             }
           else
             {
               NS_LOG_INFO (
                 "Added retx packet on stream " << sub.GetStreamId () << " with offset " << sub.GetOffset ());
-              AddScheduleItem (CreateObject<QuicSocketTxScheduleItem> (sub.GetStreamId (), sub.GetOffset (), GetDeadline (item).GetSeconds (), item), false);
+              AddScheduleItem (Create<QuicSocketTxScheduleItem> (sub.GetStreamId (), sub.GetOffset (), GetDeadline (item).GetSeconds (), item), false);
             }
         }
     }
@@ -144,7 +149,7 @@ void QuicSocketTxEdfScheduler::Add (Ptr<QuicSocketTxItem> item, bool retx)
       item->m_packet->PeekHeader (sub);
       NS_LOG_INFO (
         "Added packet on stream " << sub.GetStreamId () << " with offset " << sub.GetOffset ());
-      AddScheduleItem (CreateObject<QuicSocketTxScheduleItem> (sub.GetStreamId (), sub.GetOffset (), GetDeadline (item).GetSeconds (), item), retx);
+      AddScheduleItem (Create<QuicSocketTxScheduleItem> (sub.GetStreamId (), sub.GetOffset (), GetDeadline (item).GetSeconds (), item), retx);
     }
 }
 
@@ -156,9 +161,10 @@ void QuicSocketTxEdfScheduler::SetLatency (uint32_t streamId, Time latency)
 const Time QuicSocketTxEdfScheduler::GetLatency (uint32_t streamId)
 {
   Time latency = m_defaultLatency;
-  if (m_latencyMap.count (streamId) > 0)
+  std::map<uint32_t, Time>::const_iterator it = m_latencyMap.find (streamId);
+  if (it != m_latencyMap.end ())
     {
-      latency = m_latencyMap.at (streamId);
+      latency = it->second;
     }
   else
     {
@@ -178,6 +184,54 @@ const Time QuicSocketTxEdfScheduler::GetDefaultLatency ()
   return m_defaultLatency;
 }
 
+Time QuicSocketTxEdfScheduler::GetHeadDeadline () const
+{
+  Ptr<QuicSocketTxScheduleItem> head = PeekScheduleItem ();
+  if (head == nullptr)
+    {
+      return Time::Max ();
+    }
+  if (head->GetPriority () < 0)
+    {
+      return Simulator::Now ();
+    }
+  if (head->IsLate ())
+    {
+      return Seconds (head->GetPriority ()) - m_latePenalty;
+    }
+  return Seconds (head->GetPriority ());
+}
+
+uint32_t QuicSocketTxEdfScheduler::DeprioritizeLateFrames (Time deliveryTime)
+{
+  NS_LOG_FUNCTION (this << deliveryTime);
+
+  if (!m_latePenalty.IsStrictlyPositive ())
+    {
+      return 0;
+    }
+
+  // each frame is moved at most once: stop when a late one is back at the
+  // head
+  uint32_t late = 0;
+  Ptr<QuicSocketTxScheduleItem> head = PeekScheduleItem ();
+  while (head != nullptr and head->GetPriority () >= 0 and !head->IsLate ()
+         and Seconds (head->GetPriority ()) < deliveryTime)
+    {
+      PopScheduleItem ();
+      NS_LOG_INFO ("Frame on stream " << head->GetStreamId () << " with offset " << head->GetOffset ()
+                                      << " cannot meet its deadline " << head->GetPriority ());
+      // the frame stays first in its stream, as the receiver cannot deliver
+      // the following ones before it: the whole stream yields to the others
+      head->SetPriority (head->GetPriority () + m_latePenalty.GetSeconds ());
+      head->SetLate ();
+      ReturnScheduleItem (head);
+      ++late;
+      head = PeekScheduleItem ();
+    }
+  return late;
+}
+
 Time QuicSocketTxEdfScheduler::GetDeadline (Ptr<QuicSocketTxItem> item)
 {
   Ptr<Packet> packet = item->m_packet;
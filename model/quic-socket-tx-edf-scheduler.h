@@ -92,6 +92,30 @@ public:
    */
   const Time GetDefaultLatency ();
 
+  /**
+   * Get the deadline of the frame at the head of the scheduling list
+   *
+   * Frames moved by DeprioritizeLateFrames report their original deadline,
+   * not the postponed one, so that they are not sent on a slower path.
+   *
+   * \return the deadline, the current time for retransmissions sent first,
+   * or Time::Max () if there are no frames
+   */
+  Time GetHeadDeadline () const;
+
+  /**
+   * Move the streams whose first frame cannot meet its deadline behind the other ones
+   *
+   * The deadline of each late frame is postponed by the LatePenalty
+   * attribute, so that the late streams keep their order. A late frame stays
+   * first in its stream, as the receiver cannot deliver the following frames
+   * before it. Stream frames are reliable, so they are never dropped
+   *
+   * \param deliveryTime the earliest time at which a frame sent now can be delivered
+   * \return the number of frames moved
+   */
+  uint32_t DeprioritizeLateFrames (Time deliveryTime);
+
 private:
   /**
    * Gets the deadline for a transmission item
@@ -100,6 +124,7 @@ private:
   Time GetDeadline (Ptr<QuicSocketTxItem> item);
 
   bool m_retxFirst;
+  Time m_latePenalty;                      //!< Deadline postponement of the frames that cannot meet their deadline
   Time m_defaultLatency;
   std::map<uint32_t, Time> m_latencyMap;
 };
@@ -82,7 +82,7 @@ QuicSocketTxPFifoScheduler::Add (Ptr<QuicSocketTxItem> item, bool retx)
     {
       NS_LOG_INFO ("Retransmitted item, add at beginning (offset " << qsb.GetOffset () << ")");
     }
-  AddScheduleItem (CreateObject<QuicSocketTxScheduleItem> (qsb.GetStreamId (), qsb.GetOffset (), 0, item), (retx && m_retxFirst));
+  AddScheduleItem (Create<QuicSocketTxScheduleItem> (qsb.GetStreamId (), qsb.GetOffset (), 0, item), (retx && m_retxFirst));
 }
 
 
@@ -41,16 +41,17 @@ namespace ns3 {
 NS_LOG_COMPONENT_DEFINE ("QuicSocketTxScheduler");
 
 NS_OBJECT_ENSURE_REGISTERED (QuicSocketTxScheduler);
-NS_OBJECT_ENSURE_REGISTERED (QuicSocketTxScheduleItem);
 
-TypeId
-QuicSocketTxScheduleItem::GetTypeId (void)
+void *
+QuicSocketTxScheduleItem::operator new (std::size_t size)
 {
-  static TypeId tid = TypeId ("ns3::QuicSocketTxScheduleItem")
-    .SetParent<Object> ()
-    .SetGroupName ("Internet")
-  ;
-  return tid;
+  return QuicItemPool<QuicSocketTxScheduleItem>::Allocate (size);
+}
+
+void
+QuicSocketTxScheduleItem::operator delete (void *p, std::size_t size)
+{
+  QuicItemPool<QuicSocketTxScheduleItem>::Release (p, size);
 }
 
 int
@@ -78,15 +79,26 @@ QuicSocketTxScheduleItem::QuicSocketTxScheduleItem (uint64_t id, uint64_t off, d
   : m_streamId (id), 
     m_offset (off), 
     m_priority (p), 
-    m_item (it)
+    m_item (it),
+    m_split (false),
+    m_fin (false),
+    m_sent (0),
+    m_size (it->m_packet->GetSize ()),
+    m_late (false)
 {}
 
 QuicSocketTxScheduleItem::QuicSocketTxScheduleItem (const QuicSocketTxScheduleItem &other)
-  : m_streamId (other.m_streamId), 
+  : SimpleRefCount<QuicSocketTxScheduleItem> (other),
+    m_streamId (other.m_streamId), 
     m_offset (other.m_offset), 
-    m_priority (other.m_priority)
+    m_priority (other.m_priority),
+    m_split (other.m_split),
+    m_fin (other.m_fin),
+    m_sent (other.m_sent),
+    m_size (other.m_size),
+    m_late (other.m_late)
 {
-  m_item = CreateObject<QuicSocketTxItem> (*(other.m_item));
+  m_item = Create<QuicSocketTxItem> (*(other.m_item));
 }
 
 
@@ -121,6 +133,87 @@ QuicSocketTxScheduleItem::SetPriority (double priority)
   m_priority = priority;
 }
 
+bool
+QuicSocketTxScheduleItem::IsLate () const
+{
+  return m_late;
+}
+
+void
+QuicSocketTxScheduleItem::SetLate ()
+{
+  m_late = true;
+}
+
+uint32_t
+QuicSocketTxScheduleItem::GetSize () const
+{
+  return m_size;
+}
+
+uint32_t
+QuicSocketTxScheduleItem::GetFrameHeaderSize (uint32_t length, bool fin) const
+{
+  return QuicSubheader::CreateStreamSubHeader (m_streamId, m_offset, length, m_offset != 0,
+                                               true, fin).GetSerializedSize ();
+}
+
+Ptr<Packet>
+QuicSocketTxScheduleItem::GetFrame () const
+{
+  if (!m_split)
+    {
+      return m_item->m_packet;
+    }
+  uint32_t length = m_item->m_packet->GetSize () - m_sent;
+  Ptr<Packet> frame = m_item->m_packet->CreateFragment (m_sent, length);
+  frame->AddHeader (QuicSubheader::CreateStreamSubHeader (m_streamId, m_offset, length, m_offset != 0,
+                                                          true, m_fin));
+  return frame;
+}
+
+Ptr<Packet>
+QuicSocketTxScheduleItem::SplitFrame (uint32_t maxSize)
+{
+  if (!m_split)
+    {
+      QuicSubheader qsb;
+      m_item->m_packet->RemoveHeader (qsb);
+      m_offset = qsb.GetOffset ();
+      m_fin = qsb.IsStreamFin ();
+      m_split = true;
+    }
+
+  uint32_t remaining = m_item->m_packet->GetSize () - m_sent;
+  uint32_t headerSize = GetFrameHeaderSize (remaining, false);
+  Ptr<Packet> frame = nullptr;
+  if (maxSize > headerSize and remaining > 0)
+    {
+      uint32_t length = std::min (maxSize - headerSize, remaining);
+      // a shorter length may need a shorter field, so the frame can take
+      // the bytes saved and still fill maxSize exactly
+      uint32_t shortHeaderSize = GetFrameHeaderSize (length, false);
+      if (shortHeaderSize < headerSize)
+        {
+          uint32_t longer = std::min (length + headerSize - shortHeaderSize, remaining);
+          if (GetFrameHeaderSize (longer, false) + longer <= maxSize)
+            {
+              length = longer;
+            }
+        }
+
+      frame = m_item->m_packet->CreateFragment (m_sent, length);
+      frame->AddHeader (QuicSubheader::CreateStreamSubHeader (m_streamId, m_offset, length, m_offset != 0,
+                                                              true, m_fin and length == remaining));
+      m_sent += length;
+      m_offset += length;
+      remaining -= length;
+    }
+
+  m_size = GetFrameHeaderSize (remaining, m_fin) + remaining;
+  return frame;
+}
+
 
 
 TypeId
@@ -136,17 +229,19 @@ QuicSocketTxScheduler::GetTypeId (void)
 
 QuicSocketTxScheduler::QuicSocketTxScheduler () : m_appSize (0)
 {
-  m_appList = QuicTxPacketList ();
 }
 
-QuicSocketTxScheduler::QuicSocketTxScheduler (const QuicSocketTxScheduler &other) : m_appSize (other.m_appSize)
+QuicSocketTxScheduler::QuicSocketTxScheduler (const QuicSocketTxScheduler &other)
+  : m_appSize (other.m_appSize),
+    m_streamQueues (other.m_streamQueues),
+    m_heads (other.m_heads)
 {
-  m_appList = other.m_appList;
 }
 
 QuicSocketTxScheduler::~QuicSocketTxScheduler (void)
 {
-  m_appList = QuicTxPacketList ();
+  m_streamQueues.clear ();
+  m_heads.clear ();
   m_appSize = 0;
 }
 
@@ -168,7 +263,7 @@ QuicSocketTxScheduler::Add (Ptr<QuicSocketTxItem> item, bool retx)
     {
       NS_LOG_INFO ("Retransmitted item, add at beginning (offset " << qsb.GetOffset () << ")");
     }
-  Ptr<QuicSocketTxScheduleItem> sched = CreateObject<QuicSocketTxScheduleItem> (qsb.GetStreamId (), qsb.GetOffset (), priority, item);
+  Ptr<QuicSocketTxScheduleItem> sched = Create<QuicSocketTxScheduleItem> (qsb.GetStreamId (), qsb.GetOffset (), priority, item);
   AddScheduleItem (sched, retx);
 }
 
@@ -177,18 +272,47 @@ void
 QuicSocketTxScheduler::AddScheduleItem (Ptr<QuicSocketTxScheduleItem> item, bool retx)
 {
   NS_LOG_FUNCTION (this << item);
-  m_appList.push (item);
-  m_appSize += item->GetItem ()->m_packet->GetSize ();
-  QuicSubheader qsb;
-  item->GetItem ()->m_packet->PeekHeader (qsb);
-  NS_LOG_INFO ("Adding packet on stream " << qsb.GetStreamId () << " with priority " << item->GetPriority ());
+  InsertScheduleItem (item, false);
+  m_appSize += item->GetSize ();
+  NS_LOG_INFO ("Adding packet on stream " << item->GetStreamId () << " with priority " << item->GetPriority ());
   if (!retx)
     {
-      NS_LOG_INFO ("Standard item, add at end (offset " << qsb.GetOffset () << ")");
+      NS_LOG_INFO ("Standard item, add at end (offset " << item->GetOffset () << ")");
     }
   else
     {
-      NS_LOG_INFO ("Retransmitted item, add at beginning (offset " << qsb.GetOffset () << ")");
+      NS_LOG_INFO ("Retransmitted item, add at beginning (offset " << item->GetOffset () << ")");
+    }
+}
+
+void
+QuicSocketTxScheduler::InsertScheduleItem (Ptr<QuicSocketTxScheduleItem> item, bool first)
+{
+  CompareScheduleItems before;
+  StreamQueue &queue = m_streamQueues[item->GetStreamId ()];
+
+  // new data comes after the rest of its stream, so the queue is only
+  // searched for retransmissions
+  if (first or (!queue.empty () and before (item, queue.front ())))
+    {
+      queue.push_front (item);
+    }
+  else if (queue.empty () or !before (item, queue.back ()))
+    {
+      queue.push_back (item);
+    }
+  else
+    {
+      queue.insert (std::upper_bound (queue.begin (), queue.end (), item, before), item);
+    }
+
+  if (queue.front () == item)
+    {
+      if (queue.size () > 1)
+        {
+          m_heads.erase (queue[1]);
+        }
+      m_heads.insert (item);
     }
 }
 
@@ -197,10 +321,8 @@ QuicSocketTxScheduler::GetNewSegment (uint32_t numBytes, uint8_t pathId)
 {
   NS_LOG_FUNCTION (this << numBytes);
   // std::cout<<"I got pathId: "<<pathId<<" and Q: "<<Q<<std::endl;
-  bool firstSegment = true;
-  Ptr<Packet> currentPacket = 0;
   Ptr<QuicSocketTxItem> currentItem = 0;
-  Ptr<QuicSocketTxItem> outItem = CreateObject<QuicSocketTxItem>();
+  Ptr<QuicSocketTxItem> outItem = Create<QuicSocketTxItem>();
   outItem->m_isStream = true;   // Packets sent with this method are always stream packets
   outItem->m_isStream0 = false;
   outItem->m_packet = Create<Packet> ();
@@ -208,110 +330,48 @@ QuicSocketTxScheduler::GetNewSegment (uint32_t numBytes, uint8_t pathId)
 
   while (m_appSize > 0 && outItemSize < numBytes)
     {
-      Ptr<QuicSocketTxScheduleItem> scheduleItem = m_appList.top ();
+      Ptr<QuicSocketTxScheduleItem> scheduleItem = PopScheduleItem ();
       currentItem = scheduleItem->GetItem ();
-      currentPacket = currentItem->m_packet;
-      m_appSize -= currentPacket->GetSize ();
-      m_appList.pop ();
+      uint32_t frameSize = scheduleItem->GetSize ();
 
-      if (outItemSize + currentItem->m_packet->GetSize ()   /*- subheaderSize*/
-          <= numBytes)       // Merge
+      if (outItemSize + frameSize <= numBytes)       // Merge
         {
           NS_LOG_LOGIC ("Add complete frame to the outItem - size "
-                        << currentItem->m_packet->GetSize ()
+                        << frameSize
                         << " m_appSize " << m_appSize);
+          NS_LOG_INFO ("Packet: stream " << scheduleItem->GetStreamId () << ", offset " << scheduleItem->GetOffset ());
 
-          QuicSubheader qsb;
-          currentPacket->PeekHeader (qsb);
-          NS_LOG_INFO ("Packet: stream " << qsb.GetStreamId () << ", offset " << qsb.GetOffset ());
-
-          // std::cout<<"Packet: stream " << qsb.GetStreamId () << ", offset " << qsb.GetOffset ()<<std::endl;
-
+          currentItem->m_packet = scheduleItem->GetFrame ();
           QuicSocketTxItem::MergeItems (*outItem, *currentItem);
-          outItemSize += currentItem->m_packet->GetSize ();
+          outItemSize += frameSize;
 
           NS_LOG_LOGIC ("Updating application buffer size: " << m_appSize);
           continue;
         }
-      else if (firstSegment)  // we cannot transmit a full packet, so let's split it and update the subheaders
+
+      // we cannot transmit the full frame, so fill the packet with its first
+      // part and keep the rest in the schedule item
+      Ptr<Packet> frame = scheduleItem->SplitFrame (numBytes - outItemSize);
+      if (frame == nullptr)
         {
-          firstSegment = false;
+          NS_LOG_INFO ("Not enough bytes even for the header");
+          ReturnScheduleItem (scheduleItem);
+          break;
+        }
 
-          // get the currentPacket subheader
-          QuicSubheader qsb;
-          currentPacket->PeekHeader (qsb);
+      NS_LOG_INFO ("Split packet on stream " << scheduleItem->GetStreamId () << ", sending " << frame->GetSize ()
+                                             << " bytes, storing from offset " << scheduleItem->GetOffset ());
 
-          // new packet size
-          int newPacketSizeInt = (int)numBytes - outItemSize - qsb.GetSerializedSize ();
- 
-          if (newPacketSizeInt <= 0)
-            {
-              NS_LOG_INFO ("Not enough bytes even for the header");
-              m_appList.push (scheduleItem);
-              m_appSize += currentPacket->GetSize ();
-              break;
-            }
-          else
-            {
-              NS_LOG_INFO ("Split packet on stream " << qsb.GetStreamId () << ", sending " << newPacketSizeInt << " bytes from offset " << qsb.GetOffset ());
-              
-              currentPacket->RemoveHeader (qsb);
-              uint32_t newPacketSize = (uint32_t)newPacketSizeInt;
-
-              NS_LOG_LOGIC ("Add incomplete frame to the outItem");
-              uint32_t totPacketSize = currentItem->m_packet->GetSize ();
-              NS_LOG_LOGIC ("Extracted " << outItemSize << " bytes");
-              uint32_t oldOffset = qsb.GetOffset();
-              uint32_t newOffset = oldOffset + newPacketSize;
-              bool oldOffBit = !(oldOffset == 0);
-              bool newOffBit = true;
-              uint32_t oldLength = qsb.GetLength ();
-              uint32_t newLength = 0;
-              bool newLengthBit = true;
-              newLength = totPacketSize - newPacketSize;
-              if (oldLength == 0)
-                {
-                  newLengthBit = false;
-                }
-              bool lengthBit = true;
-              bool oldFinBit = qsb.IsStreamFin ();
-              bool newFinBit = false;
-
-              QuicSubheader newQsbToTx = QuicSubheader::CreateStreamSubHeader (qsb.GetStreamId (),
-                                                                               oldOffset, newPacketSize, oldOffBit, lengthBit, newFinBit);
-              QuicSubheader newQsbToBuffer = QuicSubheader::CreateStreamSubHeader (qsb.GetStreamId (),
-                                                                                   newOffset, newLength, newOffBit, newLengthBit, oldFinBit);
-
-              Ptr<Packet> firstPartPacket = currentItem->m_packet->CreateFragment (
-                0, newPacketSize);
-              NS_ASSERT_MSG (firstPartPacket->GetSize () == newPacketSize,
-                             "Wrong size " << firstPartPacket->GetSize ());
-              firstPartPacket->AddHeader (newQsbToTx);
-              firstPartPacket->Print (std::cerr);
-
-              NS_LOG_INFO ("Split packet, putting second part back in application buffer - stream " << newQsbToBuffer.GetStreamId () << ", storing from offset " << newQsbToBuffer.GetOffset ());
-
-              // std::cout<< ", storing from offset " << newQsbToBuffer.GetOffset ()<< std::endl;
-
-              Ptr<Packet> secondPartPacket = currentItem->m_packet->CreateFragment (
-                newPacketSize, newLength);
-              secondPartPacket->AddHeader (newQsbToBuffer);
-
-              Ptr<QuicSocketTxItem> toBeBuffered = CreateObject<QuicSocketTxItem> (*currentItem);
-              toBeBuffered->m_packet = secondPartPacket;
-              currentItem->m_packet = firstPartPacket;
-
-              QuicSocketTxItem::MergeItems (*outItem, *currentItem);
-              outItemSize += currentItem->m_packet->GetSize ();
-
-              m_appList.push (CreateObject<QuicSocketTxScheduleItem> (scheduleItem->GetStreamId (), scheduleItem->GetOffset (), scheduleItem->GetPriority (), toBeBuffered));
-              m_appSize += toBeBuffered->m_packet->GetSize ();
-
-
-              NS_LOG_LOGIC ("Buffer size: " << m_appSize << " (put back " << toBeBuffered->m_packet->GetSize () << " bytes)");
-              break; // at most one segment
-            }
-        }
+      // the item keeps the data not sent yet, so only its frame is merged
+      Ptr<Packet> rest = currentItem->m_packet;
+      currentItem->m_packet = frame;
+      QuicSocketTxItem::MergeItems (*outItem, *currentItem);
+      currentItem->m_packet = rest;
+      outItemSize += frame->GetSize ();
+
+      ReturnScheduleItem (scheduleItem);
+      NS_LOG_LOGIC ("Buffer size: " << m_appSize << " (put back " << scheduleItem->GetSize () << " bytes)");
+      break; // at most one segment
     }
 
   NS_LOG_INFO ("Update: remaining App Size " << m_appSize << ", object size " << outItemSize);
@@ -321,6 +381,45 @@ QuicSocketTxScheduler::GetNewSegment (uint32_t numBytes, uint8_t pathId)
   return outItem;
 }
 
+Ptr<QuicSocketTxScheduleItem>
+QuicSocketTxScheduler::PeekScheduleItem () const
+{
+  if (m_heads.empty ())
+    {
+      return nullptr;
+    }
+  return *m_heads.begin ();
+}
+
+Ptr<QuicSocketTxScheduleItem>
+QuicSocketTxScheduler::PopScheduleItem ()
+{
+  NS_LOG_FUNCTION (this);
+  if (m_heads.empty ())
+    {
+      return nullptr;
+    }
+  Ptr<QuicSocketTxScheduleItem> item = *m_heads.begin ();
+  m_heads.erase (m_heads.begin ());
+  StreamQueue &queue = m_streamQueues[item->GetStreamId ()];
+  queue.pop_front ();
+  if (!queue.empty ())
+    {
+      m_heads.insert (queue.front ());
+    }
+  m_appSize -= item->GetSize ();
+  return item;
+}
+
+void
+QuicSocketTxScheduler::ReturnScheduleItem (Ptr<QuicSocketTxScheduleItem> item)
+{
+  NS_LOG_FUNCTION (this << item);
+  // the item was the first of its stream when it was extracted
+  InsertScheduleItem (item, true);
+  m_appSize += item->GetSize ();
+}
+
 uint32_t
 QuicSocketTxScheduler::AppSize (void) const
 {
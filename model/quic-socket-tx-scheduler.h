@@ -27,7 +27,11 @@
 #define QUICSOCKETTXSCHEDULER_H
 
 #include "quic-socket.h"
-#include <queue>
+#include "ns3/simple-ref-count.h"
+#include "quic-item-pool.h"
+#include <deque>
+#include <set>
+#include <unordered_map>
 #include <vector>
 
 namespace ns3 {
@@ -38,18 +42,31 @@ class QuicSocketTxItem;
  * \ingroup quic
  *
  * \brief Tx item for QUIC with priority
+ *
+ * Like QuicSocketTxItem, it is a reference-counted record allocated from a
+ * QuicItemPool.
  */
-class QuicSocketTxScheduleItem : public Object
+class QuicSocketTxScheduleItem : public SimpleRefCount<QuicSocketTxScheduleItem>
 {
 public:
+  QuicSocketTxScheduleItem (uint64_t id, uint64_t off, double p, Ptr<QuicSocketTxItem> it);
+  QuicSocketTxScheduleItem (const QuicSocketTxScheduleItem &other);
+
   /**
-   * \brief Get the type ID.
-   * \return the object TypeId
+   * \brief Allocate an item from the item pool
+   *
+   * \param size the size of the item
+   * \return the memory for the item
    */
-  static TypeId GetTypeId (void);
+  static void * operator new (std::size_t size);
 
-  QuicSocketTxScheduleItem (uint64_t id, uint64_t off, double p, Ptr<QuicSocketTxItem> it);
-  QuicSocketTxScheduleItem (const QuicSocketTxScheduleItem &other);
+  /**
+   * \brief Return the memory of an item to the item pool
+   *
+   * \param p the memory of the item
+   * \param size the size of the item
+   */
+  static void operator delete (void *p, std::size_t size);
 
   /**
    *  Compare \p this to another QuicSocketTxScheduleItem
@@ -106,20 +123,71 @@ public:
    */
   void SetPriority (double priority);
 
+  /**
+   * \brief Check if the item was moved behind the others because it cannot meet its deadline.
+   * \return true if the item is late
+   */
+  bool IsLate () const;
+
+  /**
+   * \brief Mark the item as late.
+   */
+  void SetLate ();
+
+  /**
+   * \brief Get the size of the STREAM frame still to be sent, header included.
+   * \return the size in bytes
+   */
+  uint32_t GetSize () const;
+
+  /**
+   * \brief Get the STREAM frame still to be sent.
+   * \return the frame, header included
+   */
+  Ptr<Packet> GetFrame () const;
+
+  /**
+   * \brief Extract a STREAM frame from the start of the data still to be sent
+   *
+   * The first time the item is split, the subheader is removed from its
+   * packet; the item then only keeps the offset of the data not sent yet,
+   * and the subheader of each frame is built when the frame is extracted.
+   *
+   * \param maxSize the size of the frame, header included
+   * \return the frame, or nullptr if maxSize cannot fit any data
+   */
+  Ptr<Packet> SplitFrame (uint32_t maxSize);
+
 private:
+  /**
+   * \brief Get the subheader size of a frame starting at the current offset
+   * \param length the length of the frame data
+   * \param fin true if the frame ends the stream
+   * \return the size in bytes
+   */
+  uint32_t GetFrameHeaderSize (uint32_t length, bool fin) const;
+
   uint64_t m_streamId;                //!< ID of the stream the item belongs to
   uint64_t m_offset;                  //!< offset on the stream
   double m_priority;                  //!< Priority level of the item (lowest is sent first)
   Ptr<QuicSocketTxItem> m_item;       //!< TxItem containing the packet
+  bool m_split;                       //!< True if the packet of the item holds the frame data without the subheader
+  bool m_fin;                         //!< True if the frame ends the stream (only set once split)
+  uint32_t m_sent;                    //!< Bytes of frame data already extracted (only set once split)
+  uint32_t m_size;                    //!< Size of the frame still to be sent, header included
+  bool m_late;                        //!< True if the item was moved behind the others because it cannot meet its deadline
 };
 
 
+/**
+ * \brief Order of the schedule items: true if the first item is sent before the second
+ */
 class CompareScheduleItems
 {
 public:
-  bool operator() (Ptr<QuicSocketTxScheduleItem> ita, Ptr<QuicSocketTxScheduleItem> itb)
+  bool operator() (const Ptr<QuicSocketTxScheduleItem> &ita, const Ptr<QuicSocketTxScheduleItem> &itb) const
   {
-    return (*ita) > (*itb);
+    return (*ita) < (*itb);
   }
 };
 /**
@@ -177,18 +245,52 @@ public:
    * \param item a scheduling item with priority
    * \param retx true if the item is being retransmitted
    */
-  void AddScheduleItem (Ptr<QuicSocketTxScheduleItem> item, bool retx);
+  virtual void AddScheduleItem (Ptr<QuicSocketTxScheduleItem> item, bool retx);
 
   /**
    * indicate the offset in order to out-of-order schedule
    */
   uint32_t ofo_offset = 2920; 
 
+protected:
+  /**
+   * \brief Get the item at the head of the scheduling list
+   *
+   * \return the item, or nullptr if the list is empty
+   */
+  Ptr<QuicSocketTxScheduleItem> PeekScheduleItem () const;
+
+  /**
+   * \brief Remove the next item to be sent from the scheduling list
+   *
+   * \return the item, or nullptr if the list is empty
+   */
+  virtual Ptr<QuicSocketTxScheduleItem> PopScheduleItem ();
+
+  /**
+   * \brief Put back the unsent part of the item last returned by PopScheduleItem
+   *
+   * The item must be sent before any other one of its stream.
+   *
+   * \param item the item to put back
+   */
+  virtual void ReturnScheduleItem (Ptr<QuicSocketTxScheduleItem> item);
+
+  uint32_t m_appSize;               //!< Number of bytes in the scheduling list
 
 private:
-  typedef std::priority_queue<Ptr<QuicSocketTxScheduleItem>, std::vector<Ptr<QuicSocketTxScheduleItem> >, CompareScheduleItems> QuicTxPacketList;        //!< container for data stored in the buffer
-  QuicTxPacketList m_appList;
-  uint32_t m_appSize;
+  typedef std::deque<Ptr<QuicSocketTxScheduleItem> > StreamQueue;  //!< Items of a stream, in sending order
+
+  /**
+   * \brief Insert an item in the queue of its stream and update the stream heads
+   *
+   * \param item the item
+   * \param first true if the item goes before the rest of its stream
+   */
+  void InsertScheduleItem (Ptr<QuicSocketTxScheduleItem> item, bool first);
+
+  std::unordered_map<uint64_t, StreamQueue> m_streamQueues;          //!< Items of each stream, in sending order
+  std::set<Ptr<QuicSocketTxScheduleItem>, CompareScheduleItems> m_heads;  //!< First item of each stream with buffered items
 };
 
 } // namespace ns-3
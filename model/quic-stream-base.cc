@@ -97,6 +97,7 @@ QuicStreamBase::QuicStreamBase (void)
   m_quicl5 (0),
   m_maxStreamData (0),
   m_maxAdvertisedData (0),
+  m_reportedMaxStreamData (0),
   m_sentSize (0),
   m_recvSize (0),
   m_fin (false)
@@ -457,6 +458,7 @@ QuicStreamBase::Recv (Ptr<Packet> frame, const QuicSubheader& sub, Address &addr
           NS_LOG_INFO ("Received a frame with the correct order of size " << sub.GetLength ());
          
           m_recvSize += sub.GetLength ();
+          ReportMaxStreamData ();
 
           if (m_maxAdvertisedData == 0 || m_recvSize + m_rxBuffer->Available () > m_maxAdvertisedData + m_maxDataInterval)
             {
@@ -472,13 +474,14 @@ QuicStreamBase::Recv (Ptr<Packet> frame, const QuicSubheader& sub, Address &addr
           // check if the packets in the RX buffer can be released (in order release)
           std::pair<uint64_t, uint64_t> offSetLength = m_rxBuffer->GetDeliverable (m_recvSize);
           NS_LOG_LOGIC ("Extracting " << offSetLength.second << " bytes from RxBuffer");
+          // the buffered frames are delivered one by one after the received
+          // one, instead of being merged into it
+          std::vector<Ptr<Packet> > payload;
+          payload.push_back (frame);
           if (offSetLength.second > 0)
             {
-              Ptr<Packet> payload = m_rxBuffer->Extract (offSetLength.second);
-              m_recvSize += offSetLength.second;
-              if (payload) {
-                frame->AddAtEnd (payload);
-              }
+              m_recvSize += m_rxBuffer->ExtractSegments (offSetLength.second, payload);
+              ReportMaxStreamData ();
             }
           NS_LOG_LOGIC ("Flushed RxBuffer - new offset " << m_recvSize << ", " << m_rxBuffer->Available () << "bytes available");
           SetStreamStateRecvIf (m_streamStateRecv == SIZE_KNOWN and m_rxBuffer->Size () == 0, DATA_RECVD);
@@ -490,7 +493,7 @@ QuicStreamBase::Recv (Ptr<Packet> frame, const QuicSubheader& sub, Address &addr
                   SetMaxStreamData (sub.GetMaxStreamData ());
                   NS_LOG_LOGIC ("Received window set to offset " << sub.GetMaxStreamData ());
                 }
-              m_quicl5->Recv (frame, address);
+              m_quicl5->Recv (payload, address);
             }
           else
             {
@@ -580,6 +583,21 @@ QuicStreamBase::SendMaxStreamData ()
   return m_recvSize + m_rxBuffer->Available ();
 }
 
+void
+QuicStreamBase::ReportMaxStreamData ()
+{
+  if (m_quicl5 == nullptr)
+    {
+      return;
+    }
+  uint32_t maxStreamData = SendMaxStreamData ();
+  if (maxStreamData != m_reportedMaxStreamData)
+    {
+      m_quicl5->UpdateMaxData (m_reportedMaxStreamData, maxStreamData);
+      m_reportedMaxStreamData = maxStreamData;
+    }
+}
+
 void
 QuicStreamBase::SetMaxStreamData (uint32_t maxStreamData)
 {
@@ -761,6 +779,7 @@ QuicStreamBase::SetStreamRcvBufSize (uint32_t size)
   NS_LOG_FUNCTION (this << size);
   m_streamRxBufferSize = size;
   m_rxBuffer->SetMaxBufferSize (size);
+  ReportMaxStreamData ();
 }
 
 uint32_t
@@ -774,6 +793,7 @@ void
 QuicStreamBase::UpdateRxBuf (uint32_t oldValue, uint32_t newValue)
 {
   m_rxbufTrace (oldValue, newValue);
+  ReportMaxStreamData ();
 }
 
 } // namespace ns3
@@ -142,6 +142,11 @@ public:
      */
   uint32_t SendMaxStreamData ();
 
+  /**
+   * \brief Report a change of SendMaxStreamData to the L5 protocol, which keeps their sum
+   */
+  void ReportMaxStreamData ();
+
   // void CommandFlow (uint8_t type);
 
   /**
@@ -212,6 +217,7 @@ protected:
   uint32_t m_maxStreamData;                          //!< Maximum amount of data that can be sent/received on the stream
   uint32_t m_maxAdvertisedData;                                          //!< Last advertised MaxData
   uint32_t m_maxDataInterval;                                            //!< Interval between MaxData frames
+  uint32_t m_reportedMaxStreamData;                  //!< Last SendMaxStreamData reported to the L5 protocol
   uint64_t m_sentSize;                               //!< Amount of data sent in this stream
   uint64_t m_recvSize;                               //!< Amount of data received in this stream
   bool m_fin;                                        //!< A flag indicating if the FIN bit has already been received/sent
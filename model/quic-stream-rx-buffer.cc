@@ -33,6 +33,7 @@
 // #include "ns3/ipv6-l3-protocol.h"
 // #include "ns3/ipv6-routing-protocol.h"
 #include <algorithm>
+#include <iterator>
 #include "quic-stream-rx-buffer.h"
 #include "quic-subheader.h"
 
@@ -88,7 +89,10 @@ QuicStreamRxBuffer::QuicStreamRxBuffer ()
   m_finalSize (0),
   m_maxBuffer (131072),
   m_recvFin (
-    false)
+    false),
+  m_recvOffset (0),
+  m_contiguousEnd (0),
+  m_contiguousLastOffset (0)
 {
   m_streamRecvList = QuicStreamRxPacketList ();
 }
@@ -105,67 +109,106 @@ QuicStreamRxBuffer::Add (Ptr<Packet> p, const QuicSubheader& sub)
   NS_LOG_INFO (
     "Try to append " << p->GetSize () << " bytes " << ", availSize=" << Available ());
 
-  if (p->GetSize () <= Available ())
+  if (p->GetSize () == 0)
     {
-      if (p->GetSize () > 0)
-        {
+      NS_LOG_WARN ("Discarded. Trying to insert empty packet.");
+      return false;
+    }
+
+  uint64_t start = std::max (sub.GetOffset (), m_recvOffset);
+  uint64_t end = sub.GetOffset () + p->GetSize ();
+
+  // trim the head overlapping with the previous frame
+  QuicStreamRxPacketList::iterator next = m_streamRecvList.upper_bound (start);
+  if (next != m_streamRecvList.begin ())
+    {
+      QuicStreamRxPacketList::iterator prev = std::prev (next);
+      start = std::max (start, prev->first + prev->second.m_packet->GetSize ());
+    }
 
-          QuicStreamRxItem *item = new QuicStreamRxItem ();
-          item->m_packet = p->Copy ();
-          item->m_offset = sub.GetOffset ();
-          item->m_fin = sub.IsStreamFin ();
-
-          QuicStreamRxPacketList::iterator it;
-
-          // FIN packet for the stream
-          if (sub.IsStreamFin ())
-            {
-              NS_LOG_LOGIC ("FIN packet for the stream");
-              m_finalSize = sub.GetOffset () + p->GetSize ();
-              m_recvFin = true;
-              m_streamRecvList.insert (m_streamRecvList.end (), item);
-              return true;
-            }
-
-          // Find the right place to insert packet (TODO: binary search would be more efficient)
-          bool inserted = false;
-          for (it = m_streamRecvList.begin (); it < m_streamRecvList.end ();
-               ++it)
-            {
-              if (item->m_offset == (*it)->m_offset)
-                {
-                  // Duplicate packet
-                  NS_LOG_WARN ("Discarded duplicate packet.");
-                  return false;
-                }
-              if (item->m_offset < (*it)->m_offset)
-                {
-                  m_streamRecvList.insert (it, item);
-                  NS_LOG_LOGIC ("Inserted packet");
-                  inserted = true;
-                  break;
-                }
-            }
-          // The packet is not in the buffer, append it to the end
-          if (!inserted)
-            {
-              NS_LOG_LOGIC ("Appending packet");
-              m_streamRecvList.insert (m_streamRecvList.end (), item);
-            }
-          m_numBytesInBuffer += p->GetSize ();
-          NS_LOG_INFO ("Update: Received Size = " << m_numBytesInBuffer);
-          return true;
+  if (start >= end)
+    {
+      // Duplicate packet
+      NS_LOG_WARN ("Discarded duplicate packet.");
+      return false;
+    }
 
+  // the following frames covered by the packet are replaced, while the
+  // first one extending beyond it trims its tail
+  uint32_t covered = 0;
+  QuicStreamRxPacketList::iterator last = next;
+  while (last != m_streamRecvList.end () and last->first < end)
+    {
+      uint32_t size = last->second.m_packet->GetSize ();
+      if (last->first + size > end)
+        {
+          end = last->first;
+          break;
         }
-      else
+      covered += size;
+      ++last;
+    }
+
+  if (start >= end)
+    {
+      // Duplicate packet, filling no gap between the buffered frames
+      NS_LOG_WARN ("Discarded duplicate packet.");
+      return false;
+    }
+
+  uint32_t size = end - start;
+  if (size > covered + Available ())
+    {
+      NS_LOG_WARN ("Rejected. Not enough room to buffer packet.");
+      return false;
+    }
+
+  // FIN packet for the stream
+  bool fin = sub.IsStreamFin () and end == sub.GetOffset () + p->GetSize ();
+  if (fin)
+    {
+      NS_LOG_LOGIC ("FIN packet for the stream");
+      m_finalSize = end;
+      m_recvFin = true;
+    }
+
+  QuicStreamRxItem item;
+  item.m_packet = p;
+  if (size != p->GetSize ())
+    {
+      NS_LOG_LOGIC ("Trimmed packet to [" << start << ", " << end << ")");
+      item.m_packet = p->CreateFragment (start - sub.GetOffset (), size);
+    }
+  item.m_offset = start;
+  item.m_fin = fin;
+
+  bool head = (next == m_streamRecvList.begin ());
+  m_streamRecvList.erase (next, last);
+  QuicStreamRxPacketList::iterator it = m_streamRecvList.insert (last, std::make_pair (start, item));
+  m_numBytesInBuffer += size - covered;
+  NS_LOG_LOGIC ("Inserted packet");
+
+  if (covered > 0)
+    {
+      m_contiguousEnd = 0;
+      UpdateContiguous ();
+    }
+  else if (head)
+    {
+      // the packet fills the gap before the contiguous data or starts a new run
+      if (last == m_streamRecvList.end () or last->first != end)
         {
-          NS_LOG_WARN ("Discarded. Trying to insert empty packet.");
-          return false;
+          m_contiguousEnd = end;
+          m_contiguousLastOffset = start;
         }
     }
-  NS_LOG_WARN ("Rejected. Not enough room to buffer packet.");
-  // std::cout<<"stream rx buffer, Rejected. Not enough room to buffer packet."<<std::endl;
-  return false;
+  else if (start == m_contiguousEnd)
+    {
+      ExtendContiguous (it);
+    }
+
+  NS_LOG_INFO ("Update: Received Size = " << m_numBytesInBuffer);
+  return true;
 }
 
 Ptr<Packet>
@@ -173,75 +216,150 @@ QuicStreamRxBuffer::Extract (uint32_t maxSize)
 {
   NS_LOG_FUNCTION (this << maxSize);
 
-  uint32_t extractSize = std::min (maxSize, m_numBytesInBuffer.Get());
-  NS_LOG_INFO (
-    "Requested to extract " << extractSize << " bytes from QuicStreamRxBuffer of size = " << m_numBytesInBuffer);
-
-  if (extractSize == 0)
+  std::vector<Ptr<Packet> > segments;
+  if (RemoveFrames (maxSize, segments, false) == 0)
     {
+      NS_LOG_INFO ("Nothing extracted.");
       return 0;
     }
 
+  // Merge
   Ptr<Packet> outPkt = Create<Packet> ();
+  for (std::vector<Ptr<Packet> >::iterator it = segments.begin (); it != segments.end (); ++it)
+    {
+      outPkt->AddAtEnd (*it);
+    }
 
-  QuicStreamRxPacketList::iterator it = m_streamRecvList.begin ();
+  return outPkt;
+}
 
-  while (extractSize > 0 && !m_streamRecvList.empty ()
-         && it != m_streamRecvList.end ())
-    {
-      it = m_streamRecvList.begin ();
-      Ptr<Packet> currentPacket = (*it)->m_packet;
+uint32_t
+QuicStreamRxBuffer::ExtractSegments (uint32_t maxSize, std::vector<Ptr<Packet> > &segments)
+{
+  NS_LOG_FUNCTION (this << maxSize);
+  return RemoveFrames (maxSize, segments, true);
+}
 
-      if (currentPacket->GetSize () <= extractSize)   // Merge
-        {
+uint32_t
+QuicStreamRxBuffer::RemoveFrames (uint32_t maxSize, std::vector<Ptr<Packet> > &segments,
+                                  bool delivered)
+{
+  NS_LOG_FUNCTION (this << maxSize << delivered);
 
-          outPkt->AddAtEnd (currentPacket);
-          m_streamRecvList.erase (it);
-          NS_LOG_LOGIC ("Extracted and removed packet " << (*it)->m_offset << " from RxBuffer, bytes to extract: " << extractSize);
+  uint32_t extractSize = std::min (maxSize, m_numBytesInBuffer.Get());
+  NS_LOG_INFO (
+    "Requested to extract " << extractSize << " bytes from QuicStreamRxBuffer of size = " << m_numBytesInBuffer);
 
-          m_numBytesInBuffer -= currentPacket->GetSize ();
-          extractSize -= currentPacket->GetSize ();
+  uint32_t extracted = 0;
+  while (!m_streamRecvList.empty ())
+    {
+      QuicStreamRxPacketList::iterator it = m_streamRecvList.begin ();
+      Ptr<Packet> currentPacket = it->second.m_packet;
 
-          continue;
-        }
-      else
+      if (extracted + currentPacket->GetSize () > extractSize)
         {
           break;
         }
 
-      it++;
-    }
+      segments.push_back (currentPacket);
+      NS_LOG_LOGIC ("Extracted and removed packet " << it->first << " from RxBuffer, bytes to extract: " << extractSize - extracted);
+      if (delivered)
+        {
+          // a copy of the delivered data is a duplicate
+          m_recvOffset = std::max (m_recvOffset, it->first + currentPacket->GetSize ());
+        }
+      m_streamRecvList.erase (it);
 
-  if (outPkt->GetSize () == 0)
+      m_numBytesInBuffer -= currentPacket->GetSize ();
+      extracted += currentPacket->GetSize ();
+    }
+  if (extracted > 0)
     {
-      NS_LOG_INFO ("Nothing extracted.");
-      return 0;
+      UpdateContiguous ();
     }
 
-  return outPkt;
+  return extracted;
 }
 
 std::pair<uint64_t, uint64_t>
 QuicStreamRxBuffer::GetDeliverable (uint64_t currRecvOffset)
 {
   NS_LOG_FUNCTION (this);
-  uint64_t offsetToExtract = currRecvOffset;
-  uint64_t lengthToExtract = 0;
   NS_LOG_LOGIC ("Calculating deliverable size");
 
-  QuicStreamRxPacketList::iterator i;
-
-  for (i = m_streamRecvList.begin (); i != m_streamRecvList.end (); ++i)
+  // discard the data already delivered to the stream
+  m_recvOffset = currRecvOffset;
+  bool trimmed = false;
+  while (!m_streamRecvList.empty () and m_streamRecvList.begin ()->first < currRecvOffset)
     {
-      if ((*i)->m_offset == currRecvOffset + lengthToExtract)
+      QuicStreamRxPacketList::iterator it = m_streamRecvList.begin ();
+      uint32_t size = it->second.m_packet->GetSize ();
+      trimmed = true;
+
+      if (it->first + size <= currRecvOffset)
         {
-          offsetToExtract = (*i)->m_offset;
-          lengthToExtract += (*i)->m_packet->GetSize ();
+          NS_LOG_LOGIC ("Discarded delivered packet with offset " << it->first);
+          m_numBytesInBuffer -= size;
+          m_streamRecvList.erase (it);
+          continue;
         }
-      NS_LOG_LOGIC ("Inspected packet with offset " << (*i)->m_offset);
+
+      uint32_t cut = currRecvOffset - it->first;
+      NS_LOG_LOGIC ("Trimmed " << cut << " delivered bytes from packet with offset " << it->first);
+      QuicStreamRxItem item = it->second;
+      item.m_packet = item.m_packet->CreateFragment (cut, size - cut);
+      item.m_offset = currRecvOffset;
+      m_streamRecvList.erase (it);
+      m_streamRecvList.insert (m_streamRecvList.begin (), std::make_pair (currRecvOffset, item));
+      m_numBytesInBuffer -= cut;
+    }
+  if (trimmed)
+    {
+      UpdateContiguous ();
+    }
+
+  if (m_streamRecvList.empty () or m_streamRecvList.begin ()->first != currRecvOffset)
+    {
+      return std::make_pair (currRecvOffset, 0);
     }
 
-  return std::make_pair (offsetToExtract, lengthToExtract);
+  return std::make_pair (m_contiguousLastOffset, m_contiguousEnd - currRecvOffset);
+}
+
+void
+QuicStreamRxBuffer::ExtendContiguous (QuicStreamRxPacketList::iterator it)
+{
+  NS_LOG_FUNCTION (this);
+
+  while (it != m_streamRecvList.end () and it->first == m_contiguousEnd)
+    {
+      m_contiguousLastOffset = it->first;
+      m_contiguousEnd += it->second.m_packet->GetSize ();
+      ++it;
+    }
+}
+
+void
+QuicStreamRxBuffer::UpdateContiguous ()
+{
+  NS_LOG_FUNCTION (this);
+
+  if (m_streamRecvList.empty ())
+    {
+      m_contiguousEnd = 0;
+      m_contiguousLastOffset = 0;
+      return;
+    }
+
+  // the run is still valid if the head is within it, otherwise it restarts
+  // from the head
+  QuicStreamRxPacketList::iterator head = m_streamRecvList.begin ();
+  if (head->first < m_contiguousEnd and head->first <= m_contiguousLastOffset)
+    {
+      return;
+    }
+  m_contiguousEnd = head->first;
+  ExtendContiguous (head);
 }
 
 uint32_t
@@ -292,7 +410,7 @@ QuicStreamRxBuffer::Print (std::ostream & os) const
 
   for (it = m_streamRecvList.begin (); it != m_streamRecvList.end (); ++it)
     {
-      (*it)->Print (ss);
+      it->second.Print (ss);
     }
 
   os << "Stream Recv list: \n" << ss.str () << "\n\nCurrent Status: "
@@ -136,6 +136,11 @@ public:
   /**
    * Add a packet to the receive buffer
    *
+   * The parts of the packet overlapping data already in the buffer, or
+   * already delivered, are trimmed; buffered frames entirely covered by the
+   * packet are replaced. The packet is not copied: the buffer keeps a reference to it, and it must
+   * not be modified afterwards
+   *
    * \param p a smart pointer to a packet
    * \param sub the QuicSubheader of the packet
    * \return true if the insertion was successful
@@ -145,11 +150,27 @@ public:
   /**
    * Extract maxSize bytes from the buffer
    *
+   * The data is not marked as delivered, so it can be added back to the
+   * buffer until the next GetDeliverable call moves past it
+   *
    * \param maxSize the number of bytes to be extracted
    * \return a smart pointer to the extracted packet
    */
   Ptr<Packet> Extract (uint32_t maxSize);
 
+  /**
+   * Extract up to maxSize bytes from the buffer as the list of the buffered
+   * frames, without merging them
+   *
+   * The extracted data is delivered: frames carrying it are discarded as
+   * duplicates
+   *
+   * \param maxSize the maximum number of bytes to be extracted
+   * \param segments the vector the extracted frames are appended to
+   * \return the number of bytes extracted
+   */
+  uint32_t ExtractSegments (uint32_t maxSize, std::vector<Ptr<Packet> > &segments);
+
   /**
    * Get the total amount of data received in a stream
    * which has received a frame with the FIN bit set
@@ -166,14 +187,39 @@ public:
   uint32_t Size (void) const;
 
 private:
-  // TODO consider replacing std::vector with a ordered data structure
-  typedef std::vector<QuicStreamRxItem*> QuicStreamRxPacketList;  //!< container for data stored in the buffer
+  typedef std::map<uint64_t, QuicStreamRxItem> QuicStreamRxPacketList;  //!< container for data stored in the buffer, keyed by offset
+
+  /**
+   * Remove up to maxSize bytes of frames from the head of the buffer
+   *
+   * \param maxSize the maximum number of bytes to be removed
+   * \param segments the vector the removed frames are appended to
+   * \param delivered true if the data of the removed frames is delivered
+   * \return the number of bytes removed
+   */
+  uint32_t RemoveFrames (uint32_t maxSize, std::vector<Ptr<Packet> > &segments, bool delivered);
+
+  /**
+   * Extend the contiguous run of data at the head of the buffer
+   *
+   * \param it the first frame to check
+   */
+  void ExtendContiguous (QuicStreamRxPacketList::iterator it);
+
+  /**
+   * Update the contiguous run of data after frames were removed from the
+   * head of the buffer
+   */
+  void UpdateContiguous ();
 
-  QuicStreamRxPacketList m_streamRecvList;  //!< List of received packets with additional info
+  QuicStreamRxPacketList m_streamRecvList;  //!< List of received packets with additional info, never overlapping
   TracedValue<uint32_t> m_numBytesInBuffer;              //!< Current buffer occupancy
   uint32_t m_finalSize;                     //!< Final buffer size
   uint32_t m_maxBuffer;                     //!< Maximum buffer size
   bool m_recvFin;                           //!< FIN bit reception flag
+  uint64_t m_recvOffset;                    //!< Stream offset already delivered, as of the last GetDeliverable or ExtractSegments call
+  uint64_t m_contiguousEnd;                 //!< End offset of the contiguous data at the head of the buffer
+  uint64_t m_contiguousLastOffset;          //!< Offset of the last frame of the contiguous data at the head of the buffer
 
 };
 
@@ -53,11 +53,10 @@ QuicSubheader::QuicSubheader ()
     m_firstAckBlock (0),
     m_data (0),
     m_length (0),
-    m_pathId (0)
+    m_pathId (0),
+    m_serializedSize (0)
 {
   m_reasonPhrase = std::vector<uint8_t> ();
-  m_additionalAckBlocks = std::vector<uint32_t> ();
-  m_gaps = std::vector<uint32_t> ();
 }
 
 QuicSubheader::~QuicSubheader ()
@@ -151,7 +150,13 @@ QuicSubheader::GetSerializedSize (void) const
 {
   NS_LOG_FUNCTION (this << (uint64_t)m_frameType);
 
-  return CalculateSubHeaderLength ();
+  // ns3::Packet asks for the size several times per header, so it is
+  // computed once and invalidated by the setters
+  if (m_serializedSize == 0)
+    {
+      m_serializedSize = CalculateSubHeaderLength ();
+    }
+  return m_serializedSize;
 }
 
 uint32_t
@@ -557,6 +562,7 @@ QuicSubheader::Deserialize (Buffer::Iterator start)
 {
   Buffer::Iterator i = start;
   m_frameType = i.ReadU8 ();
+  m_serializedSize = 0;
 
   NS_LOG_FUNCTION (this << (uint64_t)m_frameType);
 
@@ -651,6 +657,8 @@ QuicSubheader::Deserialize (Buffer::Iterator start)
         m_ackDelay = ReadVarInt64 (i);
         m_ackBlockCount = ReadVarInt64 (i);
         m_firstAckBlock = ReadVarInt64 (i);
+        m_gaps.clear ();
+        m_additionalAckBlocks.clear ();
         for (uint64_t j = 0; j < m_ackBlockCount; j++)
           {
             m_gaps.push_back (ReadVarInt64 (i));
@@ -738,6 +746,8 @@ QuicSubheader::Deserialize (Buffer::Iterator start)
         m_ackDelay = ReadVarInt64 (i);
         m_ackBlockCount = ReadVarInt64 (i);
         m_firstAckBlock = ReadVarInt64 (i);
+        m_gaps.clear ();
+        m_additionalAckBlocks.clear ();
         for (uint64_t j = 0; j < m_ackBlockCount; j++)
           {
             m_gaps.push_back (ReadVarInt64 (i));
@@ -971,69 +981,28 @@ QuicSubheader::WriteVarInt64 (Buffer::Iterator& i, uint64_t varInt64) const
 {
   //NS_LOG_FUNCTION(this);
 
-  uint8_t mask = 0x00;
+  // each form is written at once in network order, with the two most
+  // significant bits encoding its length
   if (varInt64 <= 63)
     {
-      uint8_t buffer[1];
-      buffer[0] = (uint8_t)varInt64;
-      i.WriteU8 (buffer[0]);
+      i.WriteU8 ((uint8_t)varInt64);
     }
   else if (varInt64 <= 16383)
     {
-      mask = 0x40;
-      uint8_t buffer[2];
-      buffer[0] = (uint8_t)(varInt64 >> 8);
-      buffer[1] = (uint8_t)varInt64;
-      buffer[0] |= mask;
-
-      for (int j = 0; j < 2; j++)
-        {
-          i.WriteU8 (buffer[j]);
-        }
+      i.WriteHtonU16 ((uint16_t)(0x4000 | varInt64));
     }
   else if (varInt64 <= 1073741823)
     {
-      mask = 0x80;
-      uint8_t buffer[4];
-      for (int i = 0; i < 4; i++)
-        {
-          buffer[i] = (uint8_t)(varInt64 >> (8 * (3 - i)));
-          //NS_LOG_INFO("WriteVarInt64 - buffer[i] " << (uint64_t)buffer[i]);
-        }
-
-      buffer[0] |= mask;
-
-      for (int j = 0; j < 4; j++)
-        {
-          i.WriteU8 (buffer[j]);
-        }
-
+      i.WriteHtonU32 ((uint32_t)(0x80000000 | varInt64));
     }
   else if (varInt64 <= 4611686018427387903)
     {
-      mask = 0xC0;
-      uint8_t buffer[8];
-
-      for (int i = 0; i < 8; i++)
-        {
-          buffer[i] = (uint8_t)(varInt64 >> (8 * (7 - i)));
-          //NS_LOG_INFO("WriteVarInt64 - buffer[i] " << (uint64_t)buffer[i]);
-        }
-
-      buffer[0] |= mask;
-
-      for (int j = 0; j < 8; j++)
-        {
-          i.WriteU8 (buffer[j]);
-        }
+      i.WriteHtonU64 (0xC000000000000000 | varInt64);
     }
   else
     {
       return;           // Error too much large
     }
-
-  //NS_LOG_INFO("WriteVarInt64 - bytestream32 " << (uint64_t)bytestream32 << " varInt64 " << varInt64 << " mask " << mask);
-
 }
 
 uint64_t
@@ -1041,32 +1010,27 @@ QuicSubheader::ReadVarInt64 (Buffer::Iterator& i)
 {
   //NS_LOG_FUNCTION(this);
 
+  // the first byte gives the length, then the whole integer is read at once
   uint8_t bytestream8 = i.ReadU8 ();
   uint8_t mask = bytestream8 & 0b11000000;
-  bytestream8 &= 0b00111111;
-
-  uint64_t bytestream64 = 0;
 
   if (mask == 0x00)
     {
-      bytestream64 = (uint64_t)bytestream8;
+      return (uint64_t)bytestream8;
     }
   else if (mask == 0x40)
     {
-      bytestream64 = ((uint64_t)bytestream8 << 8) | (uint64_t)i.ReadU8 ();
+      i.Prev ();
+      return (uint64_t)(i.ReadNtohU16 () & 0x3FFF);
     }
   else if (mask == 0x80)
     {
-      bytestream64 = ((uint64_t)bytestream8 << 24) | ((uint64_t)i.ReadU8 () << 16) | ((uint64_t)i.ReadU8 () << 8) | (uint64_t)i.ReadU8 ();
+      i.Prev ();
+      return (uint64_t)(i.ReadNtohU32 () & 0x3FFFFFFF);
     }
-  else if (mask == 0xC0)
-    {
-      bytestream64 = ((uint64_t)bytestream8 << 56) | ((uint64_t)i.ReadU8 () << 48) | ((uint64_t)i.ReadU8 () << 40) | ((uint64_t)i.ReadU8 () << 32) | ((uint64_t)i.ReadU8 () << 24) | ((uint64_t)i.ReadU8 () << 16) | ((uint64_t)i.ReadU8 () << 8) | (uint64_t)i.ReadU8 ();
-    }
-
-  //NS_LOG_INFO("ReadVarInt64 - bytestream8 " << (uint64_t)bytestream8 << " bytestream64 " << bytestream64 << " mask " << (uint64_t)mask);
 
-  return bytestream64;
+  i.Prev ();
+  return i.ReadNtohU64 () & 0x3FFFFFFFFFFFFFFF;
 }
 
 uint32_t
@@ -1280,7 +1244,7 @@ QuicSubheader::CreateStopSending (uint64_t streamId, uint16_t applicationErrorCo
 }
 
 QuicSubheader
-QuicSubheader::CreateAck (uint32_t largestAcknowledged, uint64_t ackDelay, uint32_t firstAckBlock, std::vector<uint32_t>& gaps, std::vector<uint32_t>& additionalAckBlocks)
+QuicSubheader::CreateAck (uint32_t largestAcknowledged, uint64_t ackDelay, uint32_t firstAckBlock, const QuicAckBlockList& gaps, const QuicAckBlockList& additionalAckBlocks)
 {
   NS_LOG_INFO ("Created Ack Header");
 
@@ -1458,16 +1422,18 @@ uint32_t QuicSubheader::GetAckBlockCount () const
 
 void QuicSubheader::SetAckBlockCount (uint32_t ackBlockCount)
 {
+  m_serializedSize = 0;
   m_ackBlockCount = ackBlockCount;
 }
 
-const std::vector<uint32_t>& QuicSubheader::GetAdditionalAckBlocks () const
+const QuicAckBlockList& QuicSubheader::GetAdditionalAckBlocks () const
 {
   return m_additionalAckBlocks;
 }
 
-void QuicSubheader::SetAdditionalAckBlocks (const std::vector<uint32_t>& ackBlocks)
+void QuicSubheader::SetAdditionalAckBlocks (const QuicAckBlockList& ackBlocks)
 {
+  m_serializedSize = 0;
   m_additionalAckBlocks = ackBlocks;
 }
 
@@ -1478,6 +1444,7 @@ uint64_t QuicSubheader::GetAckDelay () const
 
 void QuicSubheader::SetAckDelay (uint64_t ackDelay)
 {
+  m_serializedSize = 0;
   m_ackDelay = ackDelay;
 }
 
@@ -1488,6 +1455,7 @@ uint64_t QuicSubheader::GetConnectionId () const
 
 void QuicSubheader::SetConnectionId (uint64_t connectionId)
 {
+  m_serializedSize = 0;
   m_connectionId = connectionId;
 }
 
@@ -1498,6 +1466,7 @@ uint8_t QuicSubheader::GetData () const
 
 void QuicSubheader::SetData (uint8_t data)
 {
+  m_serializedSize = 0;
   m_data = data;
 }
 
@@ -1508,6 +1477,7 @@ uint16_t QuicSubheader::GetErrorCode () const
 
 void QuicSubheader::SetErrorCode (uint16_t errorCode)
 {
+  m_serializedSize = 0;
   m_errorCode = errorCode;
 }
 
@@ -1518,16 +1488,18 @@ uint8_t QuicSubheader::GetFrameType () const
 
 void QuicSubheader::SetFrameType (uint8_t frameType)
 {
+  m_serializedSize = 0;
   m_frameType = frameType;
 }
 
-const std::vector<uint32_t>& QuicSubheader::GetGaps () const
+const QuicAckBlockList& QuicSubheader::GetGaps () const
 {
   return m_gaps;
 }
 
-void QuicSubheader::SetGaps (const std::vector<uint32_t>& gaps)
+void QuicSubheader::SetGaps (const QuicAckBlockList& gaps)
 {
+  m_serializedSize = 0;
   m_gaps = gaps;
 }
 
@@ -1538,6 +1510,7 @@ uint32_t QuicSubheader::GetLargestAcknowledged () const
 
 void QuicSubheader::SetLargestAcknowledged (uint32_t largestAcknowledged)
 {
+  m_serializedSize = 0;
   m_largestAcknowledged = largestAcknowledged;
 }
 
@@ -1548,6 +1521,7 @@ uint64_t QuicSubheader::GetLength () const
 
 void QuicSubheader::SetLength (uint64_t length)
 {
+  m_serializedSize = 0;
   m_length = length;
 }
 
@@ -1558,6 +1532,7 @@ uint64_t QuicSubheader::GetMaxData () const
 
 void QuicSubheader::SetMaxData (uint64_t maxData)
 {
+  m_serializedSize = 0;
   m_maxData = maxData;
 }
 
@@ -1568,6 +1543,7 @@ uint64_t QuicSubheader::GetMaxStreamData () const
 
 void QuicSubheader::SetMaxStreamData (uint64_t maxStreamData)
 {
+  m_serializedSize = 0;
   m_maxStreamData = maxStreamData;
 }
 
@@ -1578,6 +1554,7 @@ uint64_t QuicSubheader::GetMaxStreamId () const
 
 void QuicSubheader::SetMaxStreamId (uint64_t maxStreamId)
 {
+  m_serializedSize = 0;
   m_maxStreamId = maxStreamId;
 }
 
@@ -1588,6 +1565,7 @@ uint64_t QuicSubheader::GetOffset () const
 
 void QuicSubheader::SetOffset (uint64_t offset)
 {
+  m_serializedSize = 0;
   NS_LOG_FUNCTION (this <<"setOffset: "<< offset);
   m_offset = offset;
 }
@@ -1599,6 +1577,7 @@ const std::vector<uint8_t>& QuicSubheader::GetReasonPhrase () const
 
 void QuicSubheader::SetReasonPhrase (const std::vector<uint8_t>& reasonPhrase)
 {
+  m_serializedSize = 0;
   m_reasonPhrase = reasonPhrase;
 }
 
@@ -1609,6 +1588,7 @@ uint64_t QuicSubheader::GetReasonPhraseLength () const
 
 void QuicSubheader::SetReasonPhraseLength (uint64_t reasonPhraseLength)
 {
+  m_serializedSize = 0;
   m_reasonPhraseLength = reasonPhraseLength;
 }
 
@@ -1619,6 +1599,7 @@ uint64_t QuicSubheader::GetSequence () const
 
 void QuicSubheader::SetSequence (uint64_t sequence)
 {
+  m_serializedSize = 0;
   m_sequence = sequence;
 }
 
@@ -1629,6 +1610,7 @@ uint64_t QuicSubheader::GetStreamId () const
 
 void QuicSubheader::SetStreamId (uint64_t streamId)
 {
+  m_serializedSize = 0;
   m_streamId = streamId;
 }
 
@@ -1641,6 +1623,7 @@ uint64_t QuicSubheader::GetFirstAckBlock () const
 
 void QuicSubheader::SetFirstAckBlock (uint64_t firstAckBlock)
 {
+  m_serializedSize = 0;
   m_firstAckBlock = firstAckBlock;
 }
 
@@ -1695,7 +1678,7 @@ QuicSubheader::CreateRemoveAddress(Address addr, uint8_t pathId)
 
 
 QuicSubheader
-QuicSubheader::CreateMpAck (uint32_t largestAcknowledged, uint64_t ackDelay, uint32_t firstAckBlock, std::vector<uint32_t>& gaps, std::vector<uint32_t>& additionalAckBlocks, uint8_t pathId)
+QuicSubheader::CreateMpAck (uint32_t largestAcknowledged, uint64_t ackDelay, uint32_t firstAckBlock, const QuicAckBlockList& gaps, const QuicAckBlockList& additionalAckBlocks, uint8_t pathId)
 {
   NS_LOG_INFO ("Created Ack Header");
 
@@ -1732,6 +1715,7 @@ Address QuicSubheader::GetAddress () const
 
 void QuicSubheader::SetAddress (Address address)
 {
+  m_serializedSize = 0;
   m_address = address;
 }
 
@@ -1740,6 +1724,7 @@ uint8_t QuicSubheader::GetPathId() const {
 }
 
 void QuicSubheader::SetPathId(uint8_t pathId) {
+  m_serializedSize = 0;
 	m_pathId = pathId;
 }
 
@@ -31,9 +31,21 @@
 #include "ns3/ipv4-address.h"
 #include "ns3/ipv6-address.h"
 #include "ns3/sequence-number.h"
+#include "quic-inline-vector.h"
 
 namespace ns3 {
 
+/**
+ * \ingroup quic
+ *
+ * \brief Gaps or additional blocks of an ACK frame
+ *
+ * Every subheader holds two of these lists, so only the few gaps of an ACK
+ * frame under moderate loss are stored inline: longer lists, up to the
+ * MaxTrackedGaps of QuicSocketBase, move to the heap
+ */
+typedef QuicInlineVector<uint32_t, 4> QuicAckBlockList;
+
 /**
  * \ingroup quic
  * \brief SubHeader for the QUIC Protocol
@@ -337,7 +349,7 @@ public:
    * \param additionalAckBlocks the vector where each field contains the number of contiguous acknowledged packets preceding the largest packet number
    * \return the generated QuicSubheader
    */
-  static QuicSubheader CreateAck (uint32_t largestAcknowledged, uint64_t ackDelay, uint32_t firstAckBlock, std::vector<uint32_t>& gaps, std::vector<uint32_t>& additionalAckBlocks);
+  static QuicSubheader CreateAck (uint32_t largestAcknowledged, uint64_t ackDelay, uint32_t firstAckBlock, const QuicAckBlockList& gaps, const QuicAckBlockList& additionalAckBlocks);
 
   /**
    * Create a Path Response subheader
@@ -386,13 +398,13 @@ public:
    * \brief Get the additional ack block vector
    * \return The additional ack block vector for this QuicSubheader
    */
-  const std::vector<uint32_t>& GetAdditionalAckBlocks () const;
+  const QuicAckBlockList& GetAdditionalAckBlocks () const;
 
   /**
    * \brief Set the additional ack block vector
    * \param ackBlocks the additional ack block vector for this QuicSubheader
    */
-  void SetAdditionalAckBlocks (const std::vector<uint32_t>& ackBlocks);
+  void SetAdditionalAckBlocks (const QuicAckBlockList& ackBlocks);
 
   /**
    * \brief Get the ack delay
@@ -458,13 +470,13 @@ public:
    * \brief Get the gap vector
    * \return The gap vector for this QuicSubheader
    */
-  const std::vector<uint32_t>& GetGaps () const;
+  const QuicAckBlockList& GetGaps () const;
 
   /**
    * \brief Set the gap vector
    * \param gaps the gap for this QuicSubheader
    */
-  void SetGaps (const std::vector<uint32_t>& gaps);
+  void SetGaps (const QuicAckBlockList& gaps);
 
   /**
    * \brief Get the largest acknowledged
@@ -787,7 +799,7 @@ public:
    * 
    * \return the generated QuicSubheader
    */
-  static QuicSubheader CreateMpAck (uint32_t largestAcknowledged, uint64_t ackDelay, uint32_t firstAckBlock, std::vector<uint32_t>& gaps, std::vector<uint32_t>& additionalAckBlocks,uint8_t pathId);
+  static QuicSubheader CreateMpAck (uint32_t largestAcknowledged, uint64_t ackDelay, uint32_t firstAckBlock, const QuicAckBlockList& gaps, const QuicAckBlockList& additionalAckBlocks,uint8_t pathId);
 
   static QuicSubheader CreatePathAbandon (uint8_t pathId, uint16_t m_errorCode);
 
@@ -839,12 +851,13 @@ private:
   uint32_t m_ackDelay;                          //!< Ack delay
   uint32_t m_ackBlockCount;                     //!< Ack block count
   uint32_t m_firstAckBlock;                     //!< First Ack block
-  std::vector<uint32_t> m_additionalAckBlocks;  //!< Additional ack blocks vector
-  std::vector<uint32_t> m_gaps;                 //!< Gaps vector
+  QuicAckBlockList m_additionalAckBlocks;       //!< Additional ack blocks vector
+  QuicAckBlockList m_gaps;                      //!< Gaps vector
   uint8_t m_data;                               //!< Data word
   uint64_t m_length;                            //!< Length
   uint8_t m_pathId;                            //!< Multipath Implementation: Path Id
   Address m_address;                            //!< Multipath Implementation: Address
+  mutable uint32_t m_serializedSize;            //!< Cached serialized size, 0 if it has to be computed
 };
 
 } // namespace ns3
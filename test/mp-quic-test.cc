@@ -0,0 +1,267 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Pan Lab, Department of Computer Science, University of Victoria
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "ns3/test.h"
+#include "ns3/log.h"
+
+#include "ns3/quic-socket-base.h"
+#include "ns3/mp-quic-subflow.h"
+#include "ns3/simulator.h"
+#include "ns3/data-rate.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("MpQuicTestSuite");
+
+/**
+ * \ingroup internet-tests
+ * \ingroup tests
+ *
+ * \brief The multipath QUIC Test
+ */
+class MpQuicTestCase : public TestCase
+{
+public:
+  /** \brief Constructor */
+  MpQuicTestCase ();
+
+private:
+  virtual void
+  DoRun (void);
+  virtual void
+  DoTeardown (void);
+
+  /** \brief Test the interleaving of the packets across the paths */
+  void
+  TestWeightedPath ();
+  /** \brief Test the size of the pacing bucket and the independence of the paths */
+  void
+  TestPacingBurst ();
+  /** \brief Test the refill of the pacing bucket */
+  void
+  TestPacingRefill ();
+  /** \brief Test the received packet numbers and the ACK ranges built from them */
+  void
+  TestReceivedPacketSet ();
+  /** \brief Pacing timer expiration, nothing to send in the test */
+  void
+  PacingExpired ();
+
+  Ptr<MpQuicSubFlow> m_pacedPath; //!< Path that empties its pacing bucket
+  Ptr<MpQuicSubFlow> m_otherPath; //!< Path that keeps its pacing bucket
+};
+
+MpQuicTestCase::MpQuicTestCase () :
+    TestCase ("MpQuic Test")
+{
+}
+
+void
+MpQuicTestCase::DoRun ()
+{
+  /*
+   * Test the interleaving of the packets across the paths:
+   * -> pick the paths of 10 packets with weights 0.3 and 0.7
+   * -> check that every prefix of the sequence follows the weights
+   * -> check that a path without weight is never picked
+   */
+  TestWeightedPath ();
+
+  /*
+   * Test the received packet numbers of a path:
+   * -> add packet numbers in order, out of order and twice
+   * -> check the merging of the ranges and the rejection of duplicates
+   * -> check the gaps and ACK blocks, with and without a limit on the gaps
+   * -> merge the oldest ranges and check that the ACK ranges are unchanged
+   */
+  TestReceivedPacketSet ();
+
+  /*
+   * Test the pacing token bucket of the paths:
+   * -> check that an idle path holds at most two segments of tokens
+   * -> empty the bucket of a path and check that the other path can still send
+   * -> check that a copied path does not share the pacing timer
+   * -> check that the tokens come back at the pacing rate
+   */
+  Simulator::Schedule (Seconds (1.0), &MpQuicTestCase::TestPacingBurst, this);
+  Simulator::Run ();
+  Simulator::Destroy ();
+}
+
+void
+MpQuicTestCase::TestWeightedPath ()
+{
+  std::vector<double> weights = {0.3, 0.7};
+  std::vector<double> credits;
+  uint32_t picked[2] = {0, 0};
+  for (uint32_t n = 1; n <= 10; n++)
+    {
+      uint8_t pathId = QuicSocketBase::PickWeightedPath (weights, credits);
+      NS_TEST_ASSERT_MSG_LT (pathId, 2, "No path picked");
+      picked[pathId]++;
+
+      // the paths are interleaved, not sent in bursts
+      NS_TEST_ASSERT_MSG_LT (std::abs (picked[0] - 0.3 * n), 1.0, "Path 0 off its share");
+      NS_TEST_ASSERT_MSG_LT (std::abs (picked[1] - 0.7 * n), 1.0, "Path 1 off its share");
+    }
+  NS_TEST_ASSERT_MSG_EQ (picked[0], 3, "Wrong number of packets on path 0");
+  NS_TEST_ASSERT_MSG_EQ (picked[1], 7, "Wrong number of packets on path 1");
+
+  // a path that cannot send gets nothing, and no path is picked without weights
+  weights = {0.0, 0.7};
+  NS_TEST_ASSERT_MSG_EQ (QuicSocketBase::PickWeightedPath (weights, credits), 1, "Wrong path");
+  weights = {0.0, 0.0};
+  NS_TEST_ASSERT_MSG_EQ (QuicSocketBase::PickWeightedPath (weights, credits), 2, "Path picked without weight");
+}
+
+void
+MpQuicTestCase::TestPacingBurst ()
+{
+  m_pacedPath = CreateObject<MpQuicSubFlow> ();
+  m_otherPath = CreateObject<MpQuicSubFlow> ();
+  for (Ptr<MpQuicSubFlow> sflow : {m_pacedPath, m_otherPath})
+    {
+      sflow->SetSegSize (1000);
+      // 1 byte every microsecond
+      sflow->m_tcb->m_pacingRate = DataRate ("8Mbps");
+      sflow->m_pacingTimer.SetFunction (&MpQuicTestCase::PacingExpired, this);
+    }
+
+  // one second of idle time only fills the bucket up to the burst
+  NS_TEST_ASSERT_MSG_EQ (m_pacedPath->PacingAllowsSend (), true, "Idle path cannot send");
+  NS_TEST_ASSERT_MSG_EQ_TOL (m_pacedPath->m_pacingTokens, 2000, 1e-3, "Bucket larger than the burst");
+
+  m_pacedPath->ConsumePacingTokens (1000);
+  NS_TEST_ASSERT_MSG_EQ (m_pacedPath->PacingAllowsSend (), true, "Burst of two segments not allowed");
+  m_pacedPath->ConsumePacingTokens (1000);
+  NS_TEST_ASSERT_MSG_EQ (m_pacedPath->m_pacingTimer.IsRunning (), true, "Empty bucket without pacing timer");
+  NS_TEST_ASSERT_MSG_EQ (m_pacedPath->PacingAllowsSend (), false, "Empty bucket allows sending");
+
+  // the empty bucket of a path does not block the other one
+  NS_TEST_ASSERT_MSG_EQ (m_otherPath->PacingAllowsSend (), true, "Path blocked by another path");
+  m_otherPath->ConsumePacingTokens (1000);
+  NS_TEST_ASSERT_MSG_EQ (m_otherPath->m_pacingTimer.IsRunning (), false, "Pacing timer armed with tokens left");
+
+  // a copy of the path, as made by a socket fork, has its own timer
+  Ptr<MpQuicSubFlow> copy = CopyObject (m_pacedPath);
+  NS_TEST_ASSERT_MSG_EQ (copy->m_pacingTimer.IsRunning (), false, "Pacing timer shared with the copy");
+  copy->m_pacingTimer.Cancel ();
+  NS_TEST_ASSERT_MSG_EQ (m_pacedPath->m_pacingTimer.IsRunning (), true, "Pacing timer cancelled by the copy");
+
+  Simulator::Schedule (MicroSeconds (500), &MpQuicTestCase::TestPacingRefill, this);
+}
+
+void
+MpQuicTestCase::TestPacingRefill ()
+{
+  NS_TEST_ASSERT_MSG_EQ (m_pacedPath->m_pacingTimer.IsRunning (), false, "Pacing timer still running");
+  NS_TEST_ASSERT_MSG_EQ (m_pacedPath->PacingAllowsSend (), true, "Bucket not refilled");
+  NS_TEST_ASSERT_MSG_EQ_TOL (m_pacedPath->m_pacingTokens, 500, 1e-3, "Wrong refill at the pacing rate");
+}
+
+void
+MpQuicTestCase::TestReceivedPacketSet ()
+{
+  MpQuicReceivedPacketSet received;
+  NS_TEST_ASSERT_MSG_EQ (received.IsEmpty (), true, "New set not empty");
+
+  // in order: a single range
+  for (uint32_t seq = 1; seq <= 3; seq++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (received.Add (SequenceNumber32 (seq)), true, "Packet rejected");
+    }
+  NS_TEST_ASSERT_MSG_EQ (received.GetRangeCount (), 1, "Wrong number of ranges");
+  NS_TEST_ASSERT_MSG_EQ (received.GetLargest (), SequenceNumber32 (3), "Wrong largest packet");
+
+  // out of order: 5 joins the range of 6, and 4 joins the two ranges around it
+  received.Add (SequenceNumber32 (6));
+  received.Add (SequenceNumber32 (5));
+  NS_TEST_ASSERT_MSG_EQ (received.GetRangeCount (), 2, "Range not extended downwards");
+  received.Add (SequenceNumber32 (10));
+  received.Add (SequenceNumber32 (4));
+  NS_TEST_ASSERT_MSG_EQ (received.GetRangeCount (), 2, "Ranges not merged");
+  NS_TEST_ASSERT_MSG_EQ (received.GetLargest (), SequenceNumber32 (10), "Wrong largest packet");
+
+  // duplicates
+  NS_TEST_ASSERT_MSG_EQ (received.Add (SequenceNumber32 (2)), false, "Duplicate accepted");
+  NS_TEST_ASSERT_MSG_EQ (received.Add (SequenceNumber32 (10)), false, "Duplicate accepted");
+  NS_TEST_ASSERT_MSG_EQ (received.GetRangeCount (), 2, "Duplicate changed the ranges");
+
+  // ranges [1, 6], [8, 8] and [10, 10]
+  received.Add (SequenceNumber32 (8));
+  QuicAckBlockList gaps;
+  QuicAckBlockList blocks;
+  received.GetAckBlocks (10, gaps, blocks);
+  NS_TEST_ASSERT_MSG_EQ (gaps.size (), 2, "Wrong number of gaps");
+  NS_TEST_ASSERT_MSG_EQ (blocks.size (), 2, "Wrong number of blocks");
+  NS_TEST_ASSERT_MSG_EQ (gaps[0], 9, "Wrong first gap");
+  NS_TEST_ASSERT_MSG_EQ (blocks[0], 8, "Wrong first block");
+  NS_TEST_ASSERT_MSG_EQ (gaps[1], 7, "Wrong second gap");
+  NS_TEST_ASSERT_MSG_EQ (blocks[1], 6, "Wrong second block");
+
+  // the last block covers the older packets
+  gaps.clear ();
+  blocks.clear ();
+  received.GetAckBlocks (1, gaps, blocks);
+  NS_TEST_ASSERT_MSG_EQ (gaps.size (), 1, "Gaps not limited");
+  NS_TEST_ASSERT_MSG_EQ (gaps[0], 9, "Wrong gap");
+  NS_TEST_ASSERT_MSG_EQ (blocks[0], 8, "Wrong block");
+
+  received.Trim (1);
+  NS_TEST_ASSERT_MSG_EQ (received.GetRangeCount (), 2, "Ranges not trimmed");
+  gaps.clear ();
+  blocks.clear ();
+  received.GetAckBlocks (10, gaps, blocks);
+  NS_TEST_ASSERT_MSG_EQ (gaps.size (), 1, "Wrong number of gaps after the trim");
+  NS_TEST_ASSERT_MSG_EQ (gaps[0], 9, "Wrong gap after the trim");
+  NS_TEST_ASSERT_MSG_EQ (blocks[0], 8, "Wrong block after the trim");
+
+  // a packet older than every range extends the oldest one
+  NS_TEST_ASSERT_MSG_EQ (received.Add (SequenceNumber32 (0)), true, "Old packet rejected");
+  NS_TEST_ASSERT_MSG_EQ (received.GetRangeCount (), 2, "Old packet not merged");
+}
+
+void
+MpQuicTestCase::PacingExpired ()
+{
+}
+
+void
+MpQuicTestCase::DoTeardown ()
+{
+  m_pacedPath = nullptr;
+  m_otherPath = nullptr;
+}
+
+/**
+ * \ingroup internet-test
+ * \ingroup tests
+ *
+ * \brief the TestSuite for the multipath QUIC test cases
+ */
+class MpQuicTestSuite : public TestSuite
+{
+public:
+  MpQuicTestSuite () :
+      TestSuite ("mp-quic", UNIT)
+  {
+    AddTestCase (new MpQuicTestCase, TestCase::QUICK);
+  }
+};
+static MpQuicTestSuite g_mpQuicTestSuite;
@@ -100,6 +100,24 @@ private:
   void
   TestQuicSubHeaderSerializeDeserialize ();
 
+  /**
+   * \brief Check the storage of the ACK block lists, inline and on the heap.
+   */
+  void
+  TestAckBlockList ();
+
+  /**
+   * \brief Check the variable-length integers around the boundaries of their lengths.
+   */
+  void
+  TestVarIntBoundaries ();
+
+  /**
+   * \brief Check that the setters invalidate the cached serialized size.
+   */
+  void
+  TestSerializedSizeCache ();
+
 };
 
 
@@ -123,6 +141,9 @@ void
 QuicSubHeaderTestCase::DoRun ()
 {
   TestQuicSubHeaderSerializeDeserialize ();
+  TestAckBlockList ();
+  TestVarIntBoundaries ();
+  TestSerializedSizeCache ();
 }
 
 
@@ -1183,6 +1204,142 @@ QuicSubHeaderTestCase::TestQuicSubHeaderSerializeDeserialize ()
 
 
 
+void
+QuicSubHeaderTestCase::TestAckBlockList ()
+{
+  // grow well past the inline capacity
+  QuicAckBlockList blocks;
+  for (uint32_t i = 0; i < 50; i++)
+    {
+      blocks.push_back (3 * i);
+    }
+  NS_TEST_ASSERT_MSG_EQ (blocks.size (), 50, "Wrong size after growth");
+  bool valid = true;
+  for (uint32_t i = 0; i < 50; i++)
+    {
+      valid = valid and blocks[i] == 3 * i;
+    }
+  NS_TEST_ASSERT_MSG_EQ (valid, true, "Values lost in the growth");
+
+  // the copy does not share the storage
+  QuicAckBlockList copy (blocks);
+  NS_TEST_ASSERT_MSG_EQ (copy.size (), 50, "Wrong size of the copy");
+  copy[10] = 1;
+  NS_TEST_ASSERT_MSG_EQ (blocks[10], 30, "Storage shared with the copy");
+  NS_TEST_ASSERT_MSG_EQ (copy.back (), 147, "Wrong last value of the copy");
+
+  // assign a long list to a short one, and a short list to a long one
+  QuicAckBlockList shortList (std::vector<uint32_t> {7, 8});
+  QuicAckBlockList assigned (shortList);
+  assigned = blocks;
+  NS_TEST_ASSERT_MSG_EQ (assigned.size (), 50, "Wrong size of a long list assigned");
+  NS_TEST_ASSERT_MSG_EQ (assigned[49], 147, "Wrong value of a long list assigned");
+  assigned = shortList;
+  NS_TEST_ASSERT_MSG_EQ (assigned.size (), 2, "Wrong size of a short list assigned");
+  NS_TEST_ASSERT_MSG_EQ (assigned[1], 8, "Wrong value of a short list assigned");
+  const QuicAckBlockList &self = assigned;
+  assigned = self;
+  NS_TEST_ASSERT_MSG_EQ (assigned.size (), 2, "Wrong size after self assignment");
+
+  // clear and reuse the list
+  blocks.clear ();
+  NS_TEST_ASSERT_MSG_EQ (blocks.empty (), true, "List not empty after clear");
+  blocks.push_back (5);
+  blocks.push_back (6);
+  blocks.pop_back ();
+  NS_TEST_ASSERT_MSG_EQ (blocks.size (), 1, "Wrong size after reuse");
+  NS_TEST_ASSERT_MSG_EQ (blocks[0], 5, "Wrong value after reuse");
+  NS_TEST_ASSERT_MSG_EQ (*blocks.begin (), 5, "Wrong first value after reuse");
+}
+
+void
+QuicSubHeaderTestCase::TestVarIntBoundaries ()
+{
+  std::vector<uint64_t> values = {0, 63, 64, 16383, 16384, 1073741823, 1073741824};
+  std::vector<uint32_t> sizes = {1, 1, 2, 2, 4, 4, 8};
+  for (uint32_t i = 0; i < values.size (); i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (QuicSubheader::GetVarInt64Size (values[i]), 8 * sizes[i],
+                             "Wrong length of " << values[i]);
+
+      Ptr<Packet> p = Create<Packet> ();
+      p->AddHeader (QuicSubheader::CreateMaxData (values[i]));
+      NS_TEST_ASSERT_MSG_EQ (p->GetSize (), 1 + sizes[i], "Wrong serialized length of " << values[i]);
+
+      QuicSubheader sub;
+      p->RemoveHeader (sub);
+      NS_TEST_ASSERT_MSG_EQ (sub.GetMaxData (), values[i], "Wrong round trip of " << values[i]);
+      NS_TEST_ASSERT_MSG_EQ (p->GetSize (), 0, "Bytes left after " << values[i]);
+    }
+}
+
+void
+QuicSubHeaderTestCase::TestSerializedSizeCache ()
+{
+  // each setter is called after the size was computed, with a value that
+  // changes the size
+  QuicSubheader sub = QuicSubheader::CreateStreamSubHeader (1, 100, 10, true, true, true);
+  NS_TEST_ASSERT_MSG_EQ (sub.GetSerializedSize (), 5, "Wrong STREAM size");
+  sub.SetStreamId (20000);
+  NS_TEST_ASSERT_MSG_EQ (sub.GetSerializedSize (), 8, "Stale size after SetStreamId");
+  sub.SetOffset (1073741824);
+  NS_TEST_ASSERT_MSG_EQ (sub.GetSerializedSize (), 14, "Stale size after SetOffset");
+  sub.SetLength (100);
+  NS_TEST_ASSERT_MSG_EQ (sub.GetSerializedSize (), 15, "Stale size after SetLength");
+  sub.SetFrameType (QuicSubheader::STREAM001);
+  NS_TEST_ASSERT_MSG_EQ (sub.GetSerializedSize (), 5, "Stale size after SetFrameType");
+
+  sub = QuicSubheader::CreateMaxData (10);
+  NS_TEST_ASSERT_MSG_EQ (sub.GetSerializedSize (), 2, "Wrong MAX_DATA size");
+  sub.SetMaxData (16384);
+  NS_TEST_ASSERT_MSG_EQ (sub.GetSerializedSize (), 5, "Stale size after SetMaxData");
+
+  sub = QuicSubheader::CreateMaxStreamData (1, 10);
+  NS_TEST_ASSERT_MSG_EQ (sub.GetSerializedSize (), 3, "Wrong MAX_STREAM_DATA size");
+  sub.SetMaxStreamData (64);
+  NS_TEST_ASSERT_MSG_EQ (sub.GetSerializedSize (), 4, "Stale size after SetMaxStreamData");
+
+  sub = QuicSubheader::CreateMaxStreamId (1);
+  NS_TEST_ASSERT_MSG_EQ (sub.GetSerializedSize (), 2, "Wrong MAX_STREAM_ID size");
+  sub.SetMaxStreamId (64);
+  NS_TEST_ASSERT_MSG_EQ (sub.GetSerializedSize (), 3, "Stale size after SetMaxStreamId");
+
+  sub = QuicSubheader::CreateNewConnectionId (1, 5);
+  NS_TEST_ASSERT_MSG_EQ (sub.GetSerializedSize (), 10, "Wrong NEW_CONNECTION_ID size");
+  sub.SetSequence (64);
+  NS_TEST_ASSERT_MSG_EQ (sub.GetSerializedSize (), 11, "Stale size after SetSequence");
+
+  sub = QuicSubheader::CreateConnectionClose (0, "ab");
+  NS_TEST_ASSERT_MSG_EQ (sub.GetSerializedSize (), 6, "Wrong CONNECTION_CLOSE size");
+  sub.SetReasonPhrase (std::vector<uint8_t> (70, 'a'));
+  sub.SetReasonPhraseLength (70);
+  NS_TEST_ASSERT_MSG_EQ (sub.GetSerializedSize (), 75, "Stale size after SetReasonPhraseLength");
+
+  sub = QuicSubheader::CreateAck (10, 0, 1, std::vector<uint32_t> (), std::vector<uint32_t> ());
+  NS_TEST_ASSERT_MSG_EQ (sub.GetSerializedSize (), 5, "Wrong ACK size");
+  sub.SetLargestAcknowledged (100);
+  NS_TEST_ASSERT_MSG_EQ (sub.GetSerializedSize (), 6, "Stale size after SetLargestAcknowledged");
+  sub.SetAckDelay (100);
+  NS_TEST_ASSERT_MSG_EQ (sub.GetSerializedSize (), 7, "Stale size after SetAckDelay");
+  sub.SetFirstAckBlock (64);
+  NS_TEST_ASSERT_MSG_EQ (sub.GetSerializedSize (), 8, "Stale size after SetFirstAckBlock");
+  sub.SetGaps (std::vector<uint32_t> {1});
+  sub.SetAdditionalAckBlocks (std::vector<uint32_t> {2});
+  sub.SetAckBlockCount (1);
+  NS_TEST_ASSERT_MSG_EQ (sub.GetSerializedSize (), 10, "Stale size after SetAckBlockCount");
+  sub.SetGaps (std::vector<uint32_t> {100});
+  NS_TEST_ASSERT_MSG_EQ (sub.GetSerializedSize (), 11, "Stale size after SetGaps");
+  sub.SetAdditionalAckBlocks (std::vector<uint32_t> {100});
+  NS_TEST_ASSERT_MSG_EQ (sub.GetSerializedSize (), 12, "Stale size after SetAdditionalAckBlocks");
+
+  sub = QuicSubheader::CreatePathAbandon (1, 10);
+  NS_TEST_ASSERT_MSG_EQ (sub.GetSerializedSize (), 3, "Wrong PATH_ABANDON size");
+  sub.SetErrorCode (64);
+  NS_TEST_ASSERT_MSG_EQ (sub.GetSerializedSize (), 4, "Stale size after SetErrorCode");
+  sub.SetPathId (64);
+  NS_TEST_ASSERT_MSG_EQ (sub.GetSerializedSize (), 5, "Stale size after SetPathId");
+}
+
 void
 QuicHeaderTestCase::DoTeardown ()
 {
@@ -28,6 +28,8 @@
 
 #include "ns3/quic-socket-rx-buffer.h"
 #include "ns3/quic-stream-rx-buffer.h"
+#include "ns3/quic-l5-protocol.h"
+#include "ns3/quic-subheader.h"
 
 using namespace ns3;
 
@@ -60,6 +62,11 @@ private:
    */
   void
   TestSocketExtract ();
+  /*
+   * \brief Test the scatter-gather reading of the Socket RX buffer
+   */
+  void
+  TestSocketSegments ();
   /**
    * \brief Test the insertion of packets in the Stream RX buffer
    */
@@ -70,6 +77,26 @@ private:
    */
   void
   TestStreamExtract ();
+  /**
+   * \brief Test the trimming of packets overlapping the Stream RX buffer contents
+   */
+  void
+  TestStreamOverlap ();
+  /**
+   * \brief Test the deliverable data of the Stream RX buffer after a partial delivery
+   */
+  void
+  TestStreamDelivery ();
+  /**
+   * \brief Test the rejection of duplicate packets in the Stream RX buffer
+   */
+  void
+  TestStreamDuplicate ();
+  /**
+   * \brief Test the splitting of a received packet into its frames
+   */
+  void
+  TestDisgregate ();
 };
 
 QuicRxBufferTestCase::QuicRxBufferTestCase () :
@@ -97,6 +124,14 @@ QuicRxBufferTestCase::DoRun ()
    */
   TestSocketExtract ();
 
+  /*
+   * Test the scatter-gather reading of the Socket RX buffer
+   * -> add 3 packets
+   * -> get the segments, with the last one split, and check the buffer is untouched
+   * -> consume part of the data and check the remaining segments
+   */
+  TestSocketSegments ();
+
   /*
    * Test the insertion of packets in the Stream RX buffer:
    * -> add packets till stream tx buffer overflow
@@ -115,6 +150,40 @@ QuicRxBufferTestCase::DoRun ()
    * -> check correctness of buffer application size and available size
    */
   TestStreamExtract ();
+
+  /*
+   * Test the trimming of overlapping packets in the Stream RX buffer:
+   * -> add packets overlapping the head and the tail of buffered packets
+   * -> add a packet covering several buffered packets
+   * -> add FIN packets with the tail and with the head trimmed
+   * -> check correctness of buffer size, deliverable data and final size
+   */
+  TestStreamOverlap ();
+
+  /*
+   * Test the delivery of part of the data of the Stream RX buffer:
+   * -> add 3 packets and extract the first one
+   * -> check that the extracted data is discarded as a duplicate
+   * -> check the deliverable data from an offset inside a packet
+   */
+  TestStreamDelivery ();
+
+  /*
+   * Test the rejection of duplicate packets in the Stream RX buffer:
+   * -> add 2 adjacent packets and a packet overlapping both of them
+   * -> deliver the first packet and add it again
+   * -> rewind the delivered offset and add it again
+   * -> check correctness of buffer size and deliverable data
+   */
+  TestStreamDuplicate ();
+
+  /*
+   * Test the splitting of a received packet into its frames:
+   * -> split a packet with stream frames around a frame without payload
+   * -> split a packet ending with a stream frame without length field
+   * -> check that a frame longer than the packet drops the packet
+   */
+  TestDisgregate ();
 }
 
 void
@@ -204,6 +273,47 @@ QuicRxBufferTestCase::TestSocketExtract ()
   NS_TEST_ASSERT_MSG_EQ(out, 0, "Packet size differs from expected");
 }
 
+void
+QuicRxBufferTestCase::TestSocketSegments ()
+{
+  // create the buffer
+  QuicSocketRxBuffer rxBuf;
+  rxBuf.SetMaxBufferSize (3600);
+
+  // add 3 packets to the socket rx buffer
+  rxBuf.Add (Create<Packet> (1200));
+  rxBuf.Add (Create<Packet> (1200));
+  rxBuf.Add (Create<Packet> (1200));
+
+  // get the segments without removing them
+  std::vector<Ptr<const Packet> > segments;
+  uint32_t size = rxBuf.GetSegments (3000, segments);
+  NS_TEST_ASSERT_MSG_EQ(size, 3000, "Segments size differs from expected");
+  NS_TEST_ASSERT_MSG_EQ(segments.size (), 3, "Number of segments differs from expected");
+  NS_TEST_ASSERT_MSG_EQ(segments[2]->GetSize (), 600,
+                        "Segment size differs from expected");
+  NS_TEST_ASSERT_MSG_EQ(rxBuf.Size (), 3600, "Buffer size differs from expected");
+
+  // consume part of the data
+  uint32_t consumed = rxBuf.Consume (1800);
+  NS_TEST_ASSERT_MSG_EQ(consumed, 1800, "Consumed size differs from expected");
+  NS_TEST_ASSERT_MSG_EQ(rxBuf.Available (), 1800,
+                        "Availability differs from expected");
+  NS_TEST_ASSERT_MSG_EQ(rxBuf.Size (), 1800, "Buffer size differs from expected");
+
+  segments.clear ();
+  size = rxBuf.GetSegments (3600, segments);
+  NS_TEST_ASSERT_MSG_EQ(size, 1800, "Segments size differs from expected");
+  NS_TEST_ASSERT_MSG_EQ(segments.size (), 2, "Number of segments differs from expected");
+  NS_TEST_ASSERT_MSG_EQ(segments[0]->GetSize (), 600,
+                        "Segment size differs from expected");
+
+  // consume more data than available
+  consumed = rxBuf.Consume (3600);
+  NS_TEST_ASSERT_MSG_EQ(consumed, 1800, "Consumed size differs from expected");
+  NS_TEST_ASSERT_MSG_EQ(rxBuf.Size (), 0, "Buffer size differs from expected");
+}
+
 void
 QuicRxBufferTestCase::TestStreamAdd ()
 {
@@ -361,6 +471,216 @@ QuicRxBufferTestCase::TestStreamExtract ()
   NS_TEST_ASSERT_MSG_EQ(rxBuf.Size (), 0, "Wrong buffer size");
 }
 
+void
+QuicRxBufferTestCase::TestStreamOverlap ()
+{
+  // create the buffer
+  QuicStreamRxBuffer rxBuf;
+  rxBuf.SetMaxBufferSize (18000);
+
+  QuicSubheader sub = QuicSubheader::CreateStreamSubHeader (1, 1200, 1200, true,
+                                                            true, false);
+  bool pos = rxBuf.Add (Create<Packet> (1200), sub);
+  NS_TEST_ASSERT_MSG_EQ(pos, true, "Failed to add packet");
+
+  // the head overlapping the buffered packet is trimmed
+  sub.SetOffset (1800);
+  pos = rxBuf.Add (Create<Packet> (1200), sub);
+  NS_TEST_ASSERT_MSG_EQ(pos, true, "Failed to add packet");
+  NS_TEST_ASSERT_MSG_EQ(rxBuf.Size (), 1800, "Wrong buffer size");
+
+  // the tail overlapping the buffered packet is trimmed
+  sub.SetOffset (0);
+  pos = rxBuf.Add (Create<Packet> (1800), sub);
+  std::pair<uint64_t, uint64_t> deliverable = rxBuf.GetDeliverable (0);
+  NS_TEST_ASSERT_MSG_EQ(pos, true, "Failed to add packet");
+  NS_TEST_ASSERT_MSG_EQ(rxBuf.Size (), 3000, "Wrong buffer size");
+  NS_TEST_ASSERT_MSG_EQ(deliverable.first, 2400, "Wrong deliverable offset value");
+  NS_TEST_ASSERT_MSG_EQ(deliverable.second, 3000, "Wrong deliverable packet size");
+  NS_TEST_ASSERT_MSG_EQ(rxBuf.Extract (3000)->GetSize (), 3000, "Wrong packet size");
+
+  // a packet covering two buffered packets replaces them
+  QuicStreamRxBuffer coverBuf;
+  coverBuf.SetMaxBufferSize (18000);
+  sub.SetOffset (1200);
+  coverBuf.Add (Create<Packet> (600), sub);
+  sub.SetOffset (2400);
+  coverBuf.Add (Create<Packet> (600), sub);
+  sub.SetOffset (600);
+  pos = coverBuf.Add (Create<Packet> (3000), sub);
+  deliverable = coverBuf.GetDeliverable (0);
+  NS_TEST_ASSERT_MSG_EQ(pos, true, "Failed to add packet");
+  NS_TEST_ASSERT_MSG_EQ(coverBuf.Size (), 3000, "Wrong buffer size");
+  NS_TEST_ASSERT_MSG_EQ(deliverable.second, 0, "Wrong deliverable packet size");
+
+  sub.SetOffset (0);
+  pos = coverBuf.Add (Create<Packet> (600), sub);
+  deliverable = coverBuf.GetDeliverable (0);
+  NS_TEST_ASSERT_MSG_EQ(pos, true, "Failed to add packet");
+  NS_TEST_ASSERT_MSG_EQ(deliverable.first, 600, "Wrong deliverable offset value");
+  NS_TEST_ASSERT_MSG_EQ(deliverable.second, 3600, "Wrong deliverable packet size");
+
+  // a FIN packet whose tail is trimmed does not end the stream, while one
+  // with only the head trimmed does
+  QuicStreamRxBuffer finBuf;
+  finBuf.SetMaxBufferSize (18000);
+  sub.SetOffset (1200);
+  finBuf.Add (Create<Packet> (1200), sub);
+  QuicSubheader finSub = QuicSubheader::CreateStreamSubHeader (1, 0, 1800, false,
+                                                               true, true);
+  pos = finBuf.Add (Create<Packet> (1800), finSub);
+  NS_TEST_ASSERT_MSG_EQ(pos, true, "Failed to add packet");
+  NS_TEST_ASSERT_MSG_EQ(finBuf.Size (), 2400, "Wrong buffer size");
+  NS_TEST_ASSERT_MSG_EQ(finBuf.GetFinalSize (), 0, "Trimmed FIN packet ended the stream");
+
+  finSub.SetOffset (1800);
+  pos = finBuf.Add (Create<Packet> (1200), finSub);
+  deliverable = finBuf.GetDeliverable (0);
+  NS_TEST_ASSERT_MSG_EQ(pos, true, "Failed to add packet");
+  NS_TEST_ASSERT_MSG_EQ(finBuf.Size (), 3000, "Wrong buffer size");
+  NS_TEST_ASSERT_MSG_EQ(finBuf.GetFinalSize (), 3000, "Wrong final size");
+  NS_TEST_ASSERT_MSG_EQ(deliverable.second, 3000, "Wrong deliverable packet size");
+}
+
+void
+QuicRxBufferTestCase::TestStreamDelivery ()
+{
+  // create the buffer
+  QuicStreamRxBuffer rxBuf;
+  rxBuf.SetMaxBufferSize (18000);
+
+  Ptr<Packet> p = Create<Packet> (1200);
+  QuicSubheader sub = QuicSubheader::CreateStreamSubHeader (1, 0, p->GetSize (), false,
+                                                            true, false);
+  for (uint64_t offset = 0; offset < 3600; offset += 1200)
+    {
+      sub.SetOffset (offset);
+      rxBuf.Add (p, sub);
+    }
+  std::pair<uint64_t, uint64_t> deliverable = rxBuf.GetDeliverable (0);
+  NS_TEST_ASSERT_MSG_EQ(deliverable.second, 3600, "Wrong deliverable packet size");
+
+  // deliver the first packet
+  std::vector<Ptr<Packet> > segments;
+  uint32_t extracted = rxBuf.ExtractSegments (1200, segments);
+  NS_TEST_ASSERT_MSG_EQ(extracted, 1200, "Wrong extracted size");
+  NS_TEST_ASSERT_MSG_EQ(segments.size (), 1, "Wrong number of segments");
+  NS_TEST_ASSERT_MSG_EQ(rxBuf.Size (), 2400, "Wrong buffer size");
+
+  // the delivered data is a duplicate, even before the next GetDeliverable
+  sub.SetOffset (0);
+  bool neg = rxBuf.Add (p, sub);
+  NS_TEST_ASSERT_MSG_EQ(neg, false, "Added delivered packet");
+  NS_TEST_ASSERT_MSG_EQ(rxBuf.Size (), 2400, "Wrong buffer size");
+
+  deliverable = rxBuf.GetDeliverable (1200);
+  NS_TEST_ASSERT_MSG_EQ(deliverable.first, 2400, "Wrong deliverable offset value");
+  NS_TEST_ASSERT_MSG_EQ(deliverable.second, 2400, "Wrong deliverable packet size");
+
+  // the stream consumed part of the second packet
+  deliverable = rxBuf.GetDeliverable (1800);
+  NS_TEST_ASSERT_MSG_EQ(rxBuf.Size (), 1800, "Wrong buffer size");
+  NS_TEST_ASSERT_MSG_EQ(deliverable.first, 2400, "Wrong deliverable offset value");
+  NS_TEST_ASSERT_MSG_EQ(deliverable.second, 1800, "Wrong deliverable packet size");
+
+  extracted = rxBuf.ExtractSegments (deliverable.second, segments);
+  NS_TEST_ASSERT_MSG_EQ(extracted, 1800, "Wrong extracted size");
+  NS_TEST_ASSERT_MSG_EQ(segments.size (), 3, "Wrong number of segments");
+  NS_TEST_ASSERT_MSG_EQ(rxBuf.Size (), 0, "Wrong buffer size");
+}
+
+void
+QuicRxBufferTestCase::TestStreamDuplicate ()
+{
+  // create the buffer
+  QuicStreamRxBuffer rxBuf;
+  rxBuf.SetMaxBufferSize (18000);
+
+  Ptr<Packet> p = Create<Packet> (1200);
+  QuicSubheader sub = QuicSubheader::CreateStreamSubHeader (1, 0, p->GetSize (), false,
+                                                            true, false);
+  rxBuf.Add (p, sub);
+  sub.SetOffset (1200);
+  rxBuf.Add (p, sub);
+
+  // the packet is trimmed at both ends down to nothing
+  sub.SetOffset (600);
+  bool neg = rxBuf.Add (p, sub);
+  std::pair<uint64_t, uint64_t> deliverable = rxBuf.GetDeliverable (0);
+  NS_TEST_ASSERT_MSG_EQ(neg, false, "Added duplicate packet");
+  NS_TEST_ASSERT_MSG_EQ(rxBuf.Size (), 2400, "Wrong buffer size");
+  NS_TEST_ASSERT_MSG_EQ(deliverable.first, 1200, "Wrong deliverable offset value");
+  NS_TEST_ASSERT_MSG_EQ(deliverable.second, 2400, "Wrong deliverable packet size");
+
+  // the delivered packet is a duplicate
+  std::vector<Ptr<Packet> > segments;
+  rxBuf.ExtractSegments (1200, segments);
+  sub.SetOffset (0);
+  neg = rxBuf.Add (p, sub);
+  NS_TEST_ASSERT_MSG_EQ(neg, false, "Added delivered packet");
+  NS_TEST_ASSERT_MSG_EQ(rxBuf.Size (), 1200, "Wrong buffer size");
+
+  // until the stream rewinds its offset
+  deliverable = rxBuf.GetDeliverable (0);
+  bool pos = rxBuf.Add (p, sub);
+  deliverable = rxBuf.GetDeliverable (0);
+  NS_TEST_ASSERT_MSG_EQ(pos, true, "Failed to add packet");
+  NS_TEST_ASSERT_MSG_EQ(rxBuf.Size (), 2400, "Wrong buffer size");
+  NS_TEST_ASSERT_MSG_EQ(deliverable.second, 2400, "Wrong deliverable packet size");
+}
+
+void
+QuicRxBufferTestCase::TestDisgregate ()
+{
+  Ptr<QuicL5Protocol> quicl5 = CreateObject<QuicL5Protocol> ();
+  std::vector< std::pair<Ptr<Packet>, QuicSubheader> > frames;
+
+  // two stream frames with length field around a MAX_DATA frame
+  Ptr<Packet> data = Create<Packet> (100);
+  data->AddHeader (QuicSubheader::CreateStreamSubHeader (1, 0, 100, false, true, false));
+  Ptr<Packet> frame = Create<Packet> ();
+  frame->AddHeader (QuicSubheader::CreateMaxData (5000));
+  data->AddAtEnd (frame);
+  frame = Create<Packet> (50);
+  frame->AddHeader (QuicSubheader::CreateStreamSubHeader (2, 0, 50, false, true, false));
+  data->AddAtEnd (frame);
+
+  bool valid = quicl5->DisgregateRecv (data, frames);
+  NS_TEST_ASSERT_MSG_EQ (valid, true, "Valid packet dropped");
+  NS_TEST_ASSERT_MSG_EQ (frames.size (), 3, "Wrong number of frames");
+  NS_TEST_ASSERT_MSG_EQ (frames[0].second.GetStreamId (), 1, "Wrong stream of the first frame");
+  NS_TEST_ASSERT_MSG_EQ (frames[0].first->GetSize (), 100, "Wrong size of the first frame");
+  NS_TEST_ASSERT_MSG_EQ (frames[1].second.IsMaxData (), true, "Wrong type of the second frame");
+  NS_TEST_ASSERT_MSG_EQ ((frames[1].first == nullptr), true, "Payload in a frame without data");
+  NS_TEST_ASSERT_MSG_EQ (frames[2].second.GetStreamId (), 2, "Wrong stream of the last frame");
+  NS_TEST_ASSERT_MSG_EQ (frames[2].first->GetSize (), 50, "Wrong size of the last frame");
+
+  // the last stream frame has no length field: it takes the rest of the packet
+  data = Create<Packet> (100);
+  data->AddHeader (QuicSubheader::CreateStreamSubHeader (1, 0, 100, false, true, false));
+  frame = Create<Packet> (80);
+  frame->AddHeader (QuicSubheader::CreateStreamSubHeader (2, 0, 0, false, false, false));
+  data->AddAtEnd (frame);
+
+  valid = quicl5->DisgregateRecv (data, frames);
+  NS_TEST_ASSERT_MSG_EQ (valid, true, "Valid packet dropped");
+  NS_TEST_ASSERT_MSG_EQ (frames.size (), 2, "Wrong number of frames");
+  NS_TEST_ASSERT_MSG_EQ (frames[0].first->GetSize (), 100, "Wrong size of the first frame");
+  NS_TEST_ASSERT_MSG_EQ (frames[1].second.GetStreamId (), 2, "Wrong stream of the last frame");
+  NS_TEST_ASSERT_MSG_EQ (frames[1].first->GetSize (), 80, "Wrong size of the last frame");
+
+  // the length of the last frame exceeds the rest of the packet
+  data = Create<Packet> (100);
+  data->AddHeader (QuicSubheader::CreateStreamSubHeader (1, 0, 100, false, true, false));
+  frame = Create<Packet> (60);
+  frame->AddHeader (QuicSubheader::CreateStreamSubHeader (2, 0, 100, false, true, false));
+  data->AddAtEnd (frame);
+
+  valid = quicl5->DisgregateRecv (data, frames);
+  NS_TEST_ASSERT_MSG_EQ (valid, false, "Truncated packet accepted");
+  NS_TEST_ASSERT_MSG_EQ (frames.size (), 0, "Frames of a dropped packet");
+}
+
 void
 QuicRxBufferTestCase::DoTeardown ()
 {
@@ -26,11 +26,15 @@
 #include "ns3/quic-socket-tx-buffer.h"
 #include "ns3/quic-stream-tx-buffer.h"
 #include "ns3/quic-socket-tx-scheduler.h"
+#include "ns3/quic-socket-tx-drr-scheduler.h"
+#include "ns3/quic-socket-tx-edf-scheduler.h"
+#include "ns3/mp-quic-scheduler.h"
 
 #include "ns3/quic-socket-base.h"
 #include "ns3/packet.h"
 #include "ns3/simulator.h"
 #include "ns3/log.h"
+#include "ns3/boolean.h"
 
 using namespace ns3;
 
@@ -63,6 +67,9 @@ private:
   /** \brief Test the acknowledgment mechanism with losses */
   void
   TestAckLoss ();
+  /** \brief Test the single pass over the ACK blocks, the rate samples and the losses */
+  void
+  TestAckMerge ();
   /** \brief Test the direct loss setting mechanism */
   void
   TestSetLoss ();
@@ -84,6 +91,21 @@ private:
   /** \brief Test the Socket TX buffer retransmission of lost packets */
   void
   TestRetransmission ();
+  /** \brief Test the weighted fair queueing scheduler */
+  void
+  TestDrrScheduler ();
+  /** \brief Test the delivery time estimate and the handling of late frames */
+  void
+  TestDeadlineScheduler ();
+  /** \brief Test that a stream with a late first frame keeps its order */
+  void
+  TestLateStream ();
+  /** \brief Test the splitting of a frame across packets */
+  void
+  TestSplitFrame ();
+  /** \brief Test the order of the frames across and within the streams */
+  void
+  TestStreamOrder ();
 };
 
 QuicTxBufferTestCase::QuicTxBufferTestCase () :
@@ -122,6 +144,15 @@ QuicTxBufferTestCase::DoRun ()
    */
   Simulator::Schedule (Seconds (0.0), &QuicTxBufferTestCase::TestAckLoss, this);
 
+  /*
+   * ACK blocks, rate samples and losses in a single pass:
+   * -> send 8 packets, the sixth one earlier than the others
+   * -> acknowledge packets 2 to 5 and check the rate sample and the loss of packet 1
+   * -> acknowledge packets 7 and 8 and check the time-based loss of packet 6
+   * -> acknowledge everything and check that the lost packets are acknowledged
+   */
+  Simulator::Schedule (Seconds (1.0), &QuicTxBufferTestCase::TestAckMerge, this);
+
   /*
    * Mark a packet as lost:
    * -> add 6 small blocks
@@ -193,6 +224,267 @@ QuicTxBufferTestCase::DoRun ()
    * -> check correctness of acked and lost packets list
    */
   TestRetransmission ();
+
+  /*
+   * Test the weighted fair queueing scheduler:
+   * -> add frames on a low priority stream and on two streams with weights 1 and 2
+   * -> check that the streams are served by class and in proportion to their weights
+   */
+  TestDrrScheduler ();
+
+  /*
+   * Test the deadline-aware path choice:
+   * -> check the delivery time estimate with an empty and a full congestion window
+   * -> add frames on two streams with different latencies to the EDF scheduler
+   * -> move the frames that miss their deadline behind the other ones
+   * -> check that a late frame at the head reports its original deadline
+   */
+  TestDeadlineScheduler ();
+
+  /*
+   * Test a stream with a late first frame in the EDF scheduler:
+   * -> add two frames on a stream, only the first of them late, and a frame on another stream
+   * -> move the late frames behind the other ones
+   * -> check that the other stream is served first, and the late stream in order
+   */
+  TestLateStream ();
+
+  /*
+   * Test the splitting of a frame across packets:
+   * -> add a frame with FIN larger than two packets
+   * -> send two packets filled exactly by the first pieces of the frame
+   * -> check the offsets of the pieces and the buffer size after each one
+   * -> send the rest and check that only the last piece has the FIN
+   */
+  TestSplitFrame ();
+
+  /*
+   * Test the order of the frames across and within the streams:
+   * -> add frames of two streams with the same priority, interleaved
+   * -> check that the streams are served by ID, each one in offset order
+   * -> retransmit the first frame of a stream with frames queued
+   * -> check that it is sent first, and the replaced head only once
+   */
+  TestStreamOrder ();
+}
+
+void
+QuicTxBufferTestCase::TestStreamOrder ()
+{
+  Ptr<QuicSocketTxScheduler> sched = CreateObject<QuicSocketTxScheduler> ();
+
+  // all the frames get the same priority, the time they are added
+  std::vector<uint64_t> streams = {2, 1, 2, 1, 1, 2, 2};
+  std::vector<uint64_t> offsets = {0, 0, 100, 100, 200, 200, 0};
+  std::vector<bool> retx = {false, false, false, false, false, false, true};
+  std::vector<uint32_t> added = {0, 1, 2, 3};
+  std::vector<uint32_t> expected = {1, 3, 0, 2};
+  for (uint32_t round = 0; round < 2; round++)
+    {
+      uint32_t expectedSize = 0;
+      for (uint32_t i : added)
+        {
+          Ptr<Packet> p = Create<Packet> (100);
+          p->AddHeader (QuicSubheader::CreateStreamSubHeader (streams[i], offsets[i], p->GetSize (),
+                                                              offsets[i] != 0, true, false));
+          expectedSize += p->GetSize ();
+          Ptr<QuicSocketTxItem> item = Create<QuicSocketTxItem> ();
+          item->m_packet = p;
+          sched->Add (item, retx[i]);
+        }
+      NS_TEST_ASSERT_MSG_EQ (sched->AppSize (), expectedSize, "Wrong buffer size");
+
+      Ptr<QuicSocketTxItem> out = sched->GetNewSegment (1200, 0);
+      NS_TEST_ASSERT_MSG_EQ (out->m_packet->GetSize (), expectedSize, "Wrong packet size");
+      for (uint32_t i : expected)
+        {
+          QuicSubheader sub;
+          out->m_packet->RemoveHeader (sub);
+          NS_TEST_ASSERT_MSG_EQ (sub.GetStreamId (), streams[i], "Wrong stream order");
+          NS_TEST_ASSERT_MSG_EQ (sub.GetOffset (), offsets[i], "Wrong offset order");
+          out->m_packet->RemoveAtStart (sub.GetLength ());
+        }
+      NS_TEST_ASSERT_MSG_EQ (sched->AppSize (), 0, "Wrong buffer size");
+
+      // the retransmission of stream 2 replaces the head of the stream, and
+      // goes before the frames of stream 1
+      added = {4, 5, 6};
+      expected = {6, 4, 5};
+    }
+}
+
+void
+QuicTxBufferTestCase::TestSplitFrame ()
+{
+  Ptr<QuicSocketTxScheduler> sched = CreateObject<QuicSocketTxScheduler> ();
+  Ptr<Packet> p = Create<Packet> (3000);
+  p->AddHeader (QuicSubheader::CreateStreamSubHeader (1, 0, p->GetSize (), false, true, true));
+  Ptr<QuicSocketTxItem> item = Create<QuicSocketTxItem> ();
+  item->m_packet = p;
+  sched->Add (item, false);
+  NS_TEST_ASSERT_MSG_EQ (sched->AppSize (), 3004, "Wrong buffer size");
+
+  // the offset field of the later pieces takes 2 bytes more than the first header
+  std::vector<uint64_t> offsets = {0, 1196, 2390};
+  std::vector<uint64_t> lengths = {1196, 1194, 610};
+  std::vector<uint32_t> appSizes = {1810, 616, 0};
+  for (uint32_t i = 0; i < offsets.size (); i++)
+    {
+      Ptr<QuicSocketTxItem> out = sched->GetNewSegment (1200, 0);
+      bool last = i + 1 == offsets.size ();
+      NS_TEST_ASSERT_MSG_EQ (out->m_packet->GetSize (), last ? 616 : 1200, "Wrong packet size");
+      QuicSubheader sub;
+      out->m_packet->RemoveHeader (sub);
+      NS_TEST_ASSERT_MSG_EQ (sub.GetStreamId (), 1, "Wrong stream");
+      NS_TEST_ASSERT_MSG_EQ (sub.GetOffset (), offsets[i], "Wrong offset of the piece");
+      NS_TEST_ASSERT_MSG_EQ (sub.GetLength (), lengths[i], "Wrong length of the piece");
+      NS_TEST_ASSERT_MSG_EQ (out->m_packet->GetSize (), lengths[i], "Wrong payload of the piece");
+      NS_TEST_ASSERT_MSG_EQ (sub.IsStreamFin (), last, "FIN on the wrong piece");
+      NS_TEST_ASSERT_MSG_EQ (sched->AppSize (), appSizes[i], "Wrong buffer size after the piece");
+    }
+
+  // a frame is not split when not even its header fits
+  p = Create<Packet> (100);
+  p->AddHeader (QuicSubheader::CreateStreamSubHeader (1, 0, p->GetSize (), false, true, false));
+  item = Create<QuicSocketTxItem> ();
+  item->m_packet = p;
+  Ptr<QuicSocketTxScheduleItem> scheduleItem = Create<QuicSocketTxScheduleItem> (1, 0, 0, item);
+  NS_TEST_ASSERT_MSG_EQ ((scheduleItem->SplitFrame (3) == nullptr), true, "Frame split without room for data");
+  NS_TEST_ASSERT_MSG_EQ (scheduleItem->GetSize (), 104, "Wrong size of the frame left");
+  NS_TEST_ASSERT_MSG_EQ (scheduleItem->GetFrame ()->GetSize (), 104, "Wrong frame left");
+}
+
+void
+QuicTxBufferTestCase::TestLateStream ()
+{
+  Ptr<QuicSocketTxEdfScheduler> sched = CreateObject<QuicSocketTxEdfScheduler> ();
+  sched->SetLatency (1, MilliSeconds (10));
+  sched->SetLatency (2, MilliSeconds (100));
+
+  // the deadlines are 10 ms and 110 ms on stream 1, and 100 ms on stream 2
+  std::vector<uint64_t> streams = {1, 1, 2};
+  std::vector<uint64_t> offsets = {0, 100, 0};
+  std::vector<Time> generated = {Seconds (0), MilliSeconds (100), Seconds (0)};
+  for (uint32_t i = 0; i < streams.size (); i++)
+    {
+      Ptr<Packet> p = Create<Packet> (100);
+      QuicSubheader sub = QuicSubheader::CreateStreamSubHeader (streams[i], offsets[i], p->GetSize (),
+                                                                offsets[i] != 0, true, false);
+      p->AddHeader (sub);
+      Ptr<QuicSocketTxItem> item = Create<QuicSocketTxItem> ();
+      item->m_packet = p;
+      item->m_generated = generated[i];
+      sched->Add (item, false);
+    }
+
+  // only the first frame of stream 1 is late, but the whole stream yields
+  NS_TEST_ASSERT_MSG_EQ (sched->DeprioritizeLateFrames (MilliSeconds (50)), 1,
+                         "Wrong number of late frames");
+  NS_TEST_ASSERT_MSG_EQ_TOL (sched->GetHeadDeadline ().GetSeconds (), 0.1, 1e-6,
+                             "Wrong head deadline");
+
+  // all the frames fit in one packet, in scheduling order
+  Ptr<QuicSocketTxItem> out = sched->GetNewSegment (1200, 0);
+  for (uint32_t i : {2, 0, 1})
+    {
+      QuicSubheader sub;
+      out->m_packet->RemoveHeader (sub);
+      NS_TEST_ASSERT_MSG_EQ (sub.GetStreamId (), streams[i], "Wrong scheduling order");
+      NS_TEST_ASSERT_MSG_EQ (sub.GetOffset (), offsets[i], "Late stream sent out of order");
+      out->m_packet->RemoveAtStart (sub.GetLength ());
+    }
+  NS_TEST_ASSERT_MSG_EQ (out->m_packet->GetSize (), 0, "Wrong packet size");
+  NS_TEST_ASSERT_MSG_EQ (sched->AppSize (), 0, "Wrong buffer size");
+}
+
+void
+QuicTxBufferTestCase::TestDeadlineScheduler ()
+{
+  // half the RTT, plus one RTT per congestion window of data ahead
+  Ptr<QuicSocketState> tcb = CreateObject<QuicSocketState> ();
+  tcb->m_smoothedRtt = MilliSeconds (100);
+  tcb->m_segmentSize = 1200;
+  tcb->m_cWnd = 12000;
+  tcb->m_bytesInFlight = 0;
+  NS_TEST_ASSERT_MSG_EQ_TOL (MpQuicScheduler::EstimateDeliveryTime (tcb).GetSeconds (), 0.05, 1e-6,
+                             "Wrong delivery time with an empty window");
+  tcb->m_bytesInFlight = 12000;
+  NS_TEST_ASSERT_MSG_EQ_TOL (MpQuicScheduler::EstimateDeliveryTime (tcb).GetSeconds (), 0.06, 1e-6,
+                             "Wrong delivery time with a full window");
+
+  Ptr<QuicSocketTxEdfScheduler> sched = CreateObject<QuicSocketTxEdfScheduler> ();
+  sched->SetLatency (1, MilliSeconds (10));
+  sched->SetLatency (2, MilliSeconds (100));
+  for (uint64_t streamId = 1; streamId <= 2; streamId++)
+    {
+      Ptr<Packet> p = Create<Packet> (1196);
+      QuicSubheader sub = QuicSubheader::CreateStreamSubHeader (streamId, 0, p->GetSize (), false,
+                                                                true, false);
+      p->AddHeader (sub);
+      Ptr<QuicSocketTxItem> item = Create<QuicSocketTxItem> ();
+      item->m_packet = p;
+      sched->Add (item, false);
+    }
+  NS_TEST_ASSERT_MSG_EQ_TOL (sched->GetHeadDeadline ().GetSeconds (), 0.01, 1e-6,
+                             "Wrong head deadline");
+
+  // the frame of stream 1 cannot be delivered in time
+  NS_TEST_ASSERT_MSG_EQ (sched->DeprioritizeLateFrames (MilliSeconds (50)), 1,
+                         "Wrong number of late frames");
+  NS_TEST_ASSERT_MSG_EQ_TOL (sched->GetHeadDeadline ().GetSeconds (), 0.1, 1e-6,
+                             "Wrong head deadline");
+
+  // both frames are late: each one is moved once, and the head reports the
+  // original deadline, which no path can meet
+  NS_TEST_ASSERT_MSG_EQ (sched->DeprioritizeLateFrames (MilliSeconds (200)), 1,
+                         "Wrong number of late frames");
+  NS_TEST_ASSERT_MSG_EQ_TOL (sched->GetHeadDeadline ().GetSeconds (), 0.01, 1e-6,
+                             "Late frame reports the postponed deadline");
+
+  std::vector<uint64_t> expected = {1, 2};
+  for (uint64_t streamId : expected)
+    {
+      Ptr<QuicSocketTxItem> out = sched->GetNewSegment (1200, 0);
+      NS_TEST_ASSERT_MSG_EQ (out->m_packet->GetSize (), 1200, "Wrong packet size");
+      QuicSubheader sub;
+      out->m_packet->PeekHeader (sub);
+      NS_TEST_ASSERT_MSG_EQ (sub.GetStreamId (), streamId, "Wrong scheduling order");
+    }
+  NS_TEST_ASSERT_MSG_EQ (sched->AppSize (), 0, "Wrong buffer size");
+}
+
+void
+QuicTxBufferTestCase::TestDrrScheduler ()
+{
+  Ptr<QuicSocketTxDrrScheduler> sched = CreateObject<QuicSocketTxDrrScheduler> ();
+  sched->SetWeight (2, 2);
+  sched->SetPriorityClass (3, 1);
+
+  // stream 3 is added first, but its class is served last
+  std::vector<uint64_t> streams = {3, 1, 1, 1, 1, 2, 2, 2, 2};
+  for (uint64_t streamId : streams)
+    {
+      Ptr<Packet> p = Create<Packet> (1196);
+      QuicSubheader sub = QuicSubheader::CreateStreamSubHeader (streamId, 0, p->GetSize (), false,
+                                                                true, false);
+      p->AddHeader (sub);
+      Ptr<QuicSocketTxItem> item = Create<QuicSocketTxItem> ();
+      item->m_packet = p;
+      sched->Add (item, false);
+    }
+  NS_TEST_ASSERT_MSG_EQ (sched->AppSize (), 10800, "Wrong buffer size");
+
+  // stream 2 sends two frames for each frame of stream 1
+  std::vector<uint64_t> expected = {1, 2, 2, 1, 2, 2, 1, 1, 3};
+  for (uint64_t streamId : expected)
+    {
+      Ptr<QuicSocketTxItem> out = sched->GetNewSegment (1200, 0);
+      NS_TEST_ASSERT_MSG_EQ (out->m_packet->GetSize (), 1200, "Wrong packet size");
+      QuicSubheader sub;
+      out->m_packet->PeekHeader (sub);
+      NS_TEST_ASSERT_MSG_EQ (sub.GetStreamId (), streamId, "Wrong scheduling order");
+    }
+  NS_TEST_ASSERT_MSG_EQ (sched->AppSize (), 0, "Wrong buffer size");
 }
 
 void
@@ -200,6 +492,8 @@ QuicTxBufferTestCase::TestRetransmission ()
 {
   // create the buffer
   QuicSocketTxBuffer txBuf;
+  // check the bytes in flight counters against the sent list on every query
+  txBuf.SetAttribute ("ValidateBytesInFlight", BooleanValue (true));
   
   Ptr<QuicSocketTxScheduler> sched = CreateObject<QuicSocketTxScheduler>();
   txBuf.SetScheduler(sched);
@@ -744,6 +1038,85 @@ QuicTxBufferTestCase::TestAckLoss ()
                         "TxBuf miscalculates size of in flight segments");
 }
 
+void
+QuicTxBufferTestCase::TestAckMerge ()
+{
+  // create the buffer
+  QuicSocketTxBuffer txBuf;
+  txBuf.SetAttribute ("ValidateBytesInFlight", BooleanValue (true));
+  Ptr<QuicSocketTxScheduler> sched = CreateObject<QuicSocketTxScheduler>();
+  txBuf.SetScheduler(sched);
+  uint8_t pathId = 0;
+  Ptr<QuicSocketState> tcbd = CreateObject<QuicSocketState> ();
+  tcbd->m_kReorderingThreshold = 3;
+  tcbd->m_kUsingTimeLossDetection = true;
+  tcbd->m_kTimeReorderingFraction = 1.0;
+  tcbd->m_smoothedRtt = MilliSeconds (100);
+
+  // send 8 packets, recording the delivery state as the socket does; packet
+  // 6 was sent half a second before the others
+  for (uint32_t pn = 1; pn <= 8; pn++)
+    {
+      Ptr<Packet> p = Create<Packet> (1196);
+      QuicSubheader sub = QuicSubheader::CreateStreamSubHeader (1, 0, p->GetSize (), false,
+                                                                true, false);
+      p->AddHeader (sub);
+      txBuf.Add (p);
+      Ptr<QuicSocketTxItem> item = txBuf.GetNewSegment (1200, SequenceNumber32 (pn), pathId);
+      item->m_lastSent = (pn == 6) ? Seconds (0.5) : Simulator::Now ();
+      item->m_delivered = (pn - 1) * 1200;
+      item->m_deliveredTime = Simulator::Now ();
+    }
+  NS_TEST_ASSERT_MSG_EQ(txBuf.BytesInFlight (pathId), 9600,
+                        "TxBuf miscalculates size of in flight segments");
+
+  // acknowledge packets 2 to 5: packet 1 is beyond the reordering threshold
+  std::vector<uint32_t> additionalAckBlocks;
+  std::vector<uint32_t> gaps;
+  gaps.push_back (1);
+  std::vector<Ptr<QuicSocketTxItem>> acked = txBuf.OnAckUpdate (tcbd, 5, additionalAckBlocks,
+                                                                gaps, pathId);
+  std::vector<Ptr<QuicSocketTxItem>> lost = txBuf.DetectLostPackets (pathId);
+  NS_TEST_ASSERT_MSG_EQ(acked.size (), 4, "Wrong number of ACKed packets");
+  NS_TEST_ASSERT_MSG_EQ(acked.front ()->m_packetNumber.GetValue (), 5, "Wrong ACKed packet");
+  NS_TEST_ASSERT_MSG_EQ(acked.back ()->m_packetNumber.GetValue (), 2, "Wrong ACKed packet");
+  NS_TEST_ASSERT_MSG_EQ(lost.size (), 1, "Wrong number of lost packets");
+  NS_TEST_ASSERT_MSG_EQ(lost.at (0)->m_packetNumber.GetValue (), 1, "Wrong lost packet");
+  NS_TEST_ASSERT_MSG_EQ(tcbd->m_delivered, 4800, "Wrong delivered data");
+  NS_TEST_ASSERT_MSG_EQ(txBuf.GetRateSample ()->m_priorDelivered, 4800,
+                        "Rate sample not taken from the latest packet");
+  NS_TEST_ASSERT_MSG_EQ(acked.front ()->m_deliveredTime, Time::Max (),
+                        "ACKed packet can still be sampled");
+  NS_TEST_ASSERT_MSG_EQ(txBuf.BytesInFlight (pathId), 4800,
+                        "TxBuf miscalculates size of in flight segments");
+
+  // acknowledge packets 7 and 8: packet 6 is within the reordering threshold,
+  // but it was sent too long before packet 8
+  gaps.clear ();
+  gaps.push_back (6);
+  acked = txBuf.OnAckUpdate (tcbd, 8, additionalAckBlocks, gaps, pathId);
+  lost = txBuf.DetectLostPackets (pathId);
+  NS_TEST_ASSERT_MSG_EQ(acked.size (), 2, "Wrong number of ACKed packets");
+  NS_TEST_ASSERT_MSG_EQ(lost.size (), 2, "Wrong number of lost packets");
+  NS_TEST_ASSERT_MSG_EQ(lost.at (1)->m_packetNumber.GetValue (), 6, "Wrong lost packet");
+  NS_TEST_ASSERT_MSG_EQ(txBuf.BytesInFlight (pathId), 2400,
+                        "TxBuf miscalculates size of in flight segments");
+
+  // a late ACK for the lost packets, before they are retransmitted
+  gaps.clear ();
+  acked = txBuf.OnAckUpdate (tcbd, 8, additionalAckBlocks, gaps, pathId);
+  NS_TEST_ASSERT_MSG_EQ(acked.size (), 2, "Lost packets not ACKed");
+  NS_TEST_ASSERT_MSG_EQ(acked.at (0)->m_packetNumber.GetValue (), 6, "Wrong ACKed packet");
+  NS_TEST_ASSERT_MSG_EQ(acked.at (1)->m_packetNumber.GetValue (), 1, "Wrong ACKed packet");
+  NS_TEST_ASSERT_MSG_EQ(txBuf.DetectLostPackets (pathId).size (), 0,
+                        "ACKed packets still to be retransmitted");
+  NS_TEST_ASSERT_MSG_EQ(tcbd->m_delivered, 9600, "Wrong delivered data");
+  NS_TEST_ASSERT_MSG_EQ(txBuf.BytesInFlight (pathId), 0,
+                        "TxBuf miscalculates size of in flight segments");
+  NS_TEST_ASSERT_MSG_EQ(txBuf.Retransmission (SequenceNumber32 (9), pathId), 0,
+                        "ACKed packets retransmitted");
+}
+
 void
 QuicTxBufferTestCase::TestSetLoss ()
 {